@@ -778,6 +778,35 @@ int noise(int argc, char** argv, ostream& os)
         return SUCCESS;
 }
 
+int txstats(int argc, char** argv, ostream& os)
+{
+	if (argc!=1) return BAD_NUM_ARGS;
+
+	for (unsigned CN=0; CN<gTRX.numARFCNs(); CN++) {
+		ARFCNManager* radio = gTRX.ARFCN(CN);
+		int latency, floor, ceiling;
+		unsigned underruns;
+		if (!radio->getTxLatency(latency,floor,ceiling,underruns)) {
+			os << "C" << CN << " transceiver does not report transmit statistics" << endl;
+			continue;
+		}
+		os << "C" << CN << " latency " << latency << " slots, radio needs " << floor
+			<< ", core bursts allow " << ceiling << ", " << underruns << " underruns" << endl;
+		os << "TN       sent     late  dropped   filled" << endl;
+		for (unsigned TN=0; TN<8; TN++) {
+			ARFCNManager::TxStats stats;
+			if (!radio->getTxStats(TN,stats)) continue;
+			os << setw(2) << TN
+				<< " " << setw(10) << stats.sent
+				<< " " << setw(8) << stats.late
+				<< " " << setw(8) << stats.dropped
+				<< " " << setw(8) << stats.filled << endl;
+		}
+	}
+
+	return SUCCESS;
+}
+
 int echofirst(int argc, char** argv, ostream& os)
 {
 	if (argc!=2) return BAD_NUM_ARGS;
@@ -900,6 +929,7 @@ Parser::Parser()
 	addCommand("power", power, "[minAtten maxAtten] -- report current attentuation or set min/max bounds");
         addCommand("rxgain", rxgain, "[newRxgain] -- get/set the RX gain in dB");
         addCommand("noise", noise, "-- report receive noise level in RSSI dB");
+	addCommand("txstats", txstats, "-- report transmit latency and late, dropped and filled bursts per timeslot");
 	addCommand("unconfig", unconfig, "key -- remove a config value");
 	addCommand("notices", notices, "-- show startup copyright and legal notices");
 	addCommand("echo", echofirst, "<string> -- print <string> to the screen");
@@ -29,6 +29,15 @@
 #include <iostream>
 #include <stdio.h>
 
+// The vectorized Viterbi kernel is built with a target attribute and
+// selected at runtime, so the library keeps the baseline instruction set.
+// 32-bit builds with x87 arithmetic keep the scalar code, whose rounding differs.
+#if (defined(__x86_64__) || defined(__SSE2_MATH__)) && defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+  #define HAVE_X86_VITERBI 1
+  #include <emmintrin.h>
+#endif
+
 using namespace std;
 
 
@@ -50,6 +59,71 @@ unsigned applyPoly(uint64_t val, uint64_t poly, unsigned order)
 
 
 
+/**@name Word access to bits, which are stored one per byte in the low bit. */
+//@{
+
+static const uint64_t sLowBits = 0x0101010101010101ULL;
+
+/** Load 8 bit bytes with the first one in the low byte. */
+static inline uint64_t loadBits(const char *dp)
+{
+	uint64_t word;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	memcpy(&word,dp,8);
+#else
+	word = 0;
+	for (int i=7; i>=0; i--) word = (word<<8) | (unsigned char)dp[i];
+#endif
+	return word;
+}
+
+/** Store 8 bit bytes with the first one from the low byte. */
+static inline void storeBits(char *dp, uint64_t word)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	memcpy(dp,&word,8);
+#else
+	for (int i=0; i<8; i++) { dp[i] = word; word >>= 8; }
+#endif
+}
+
+/** Gather 8 bits into a byte, the first bit in the MSB. */
+static inline unsigned gatherMSB8(const char *dp)
+{
+	return ((loadBits(dp) & sLowBits) * 0x8040201008040201ULL) >> 56;
+}
+
+/** Gather 8 bits into a byte, the first bit in the LSB. */
+static inline unsigned gatherLSB8(const char *dp)
+{
+	return ((loadBits(dp) & sLowBits) * 0x0102040810204080ULL) >> 56;
+}
+
+/** Spread a byte over 8 bits, where the first bit gets set bit of select. */
+static inline void scatter8(char *dp, unsigned byte, uint64_t select)
+{
+	// Each byte keeps its own bit of the copies, then becomes 0 or 1.
+	const uint64_t word = ((byte & 0xff) * sLowBits) & select;
+	storeBits(dp,((word + 0x7f7f7f7f7f7f7f7fULL) >> 7) & sLowBits);
+}
+
+/** Spread a byte over 8 bits, the MSB first. */
+static inline void scatterMSB8(char *dp, unsigned byte) { scatter8(dp,byte,0x0102040810204080ULL); }
+
+/** Spread a byte over 8 bits, the LSB first. */
+static inline void scatterLSB8(char *dp, unsigned byte) { scatter8(dp,byte,0x8040201008040201ULL); }
+
+/** Shift right, allowing for shifts past the width of the word. */
+static inline uint64_t shiftDown(uint64_t value, unsigned shift)
+{
+	return (shift<64) ? (value>>shift) : 0;
+}
+
+//@}
+
+
+
+
 
 
 BitVector::BitVector(const char *valString)
@@ -72,7 +146,11 @@ uint64_t BitVector::peekField(size_t readIndex, unsigned length) const
 	uint64_t accum = 0;
 	char *dp = mStart + readIndex;
 	assert(dp+length <= mEnd);
-	for (unsigned i=0; i<length; i++) {
+	unsigned i = 0;
+	for (; i+8<=length; i+=8, dp+=8) {
+		accum = (accum<<8) | gatherMSB8(dp);
+	}
+	for (; i<length; i++) {
 		accum = (accum<<1) | ((*dp++) & 0x01);
 	}
 	return accum;
@@ -84,10 +162,15 @@ uint64_t BitVector::peekField(size_t readIndex, unsigned length) const
 uint64_t BitVector::peekFieldReversed(size_t readIndex, unsigned length) const
 {
 	uint64_t accum = 0;
-	char *dp = mStart + readIndex + length - 1;
-	assert(dp<mEnd);
-	for (int i=(length-1); i>=0; i--) {
-		accum = (accum<<1) | ((*dp--) & 0x01);
+	const char *dp = mStart + readIndex;
+	assert(dp+length <= mEnd);
+	// Bit i of the field is the i-th bit of the vector.
+	unsigned i = 0;
+	for (; i+8<=length && i<64; i+=8) {
+		accum |= (uint64_t)gatherLSB8(dp+i) << i;
+	}
+	for (; i<length && i<64; i++) {
+		accum |= (uint64_t)(dp[i] & 0x01) << i;
 	}
 	return accum;
 }
@@ -116,12 +199,15 @@ uint64_t BitVector::readFieldReversed(size_t& readIndex, unsigned length) const
 
 void BitVector::fillField(size_t writeIndex, uint64_t value, unsigned length)
 {
-	char *dpBase = mStart + writeIndex;
-	char *dp = dpBase + length - 1;
-	assert(dp < mEnd);
-	while (dp>=dpBase) {
-		*dp-- = value & 0x01;
-		value >>= 1;
+	char *dp = mStart + writeIndex;
+	assert(dp+length <= mEnd);
+	// The first bit written is the MSB of the field.
+	unsigned i = 0;
+	for (; i+8<=length; i+=8) {
+		scatterMSB8(dp+i,shiftDown(value,length-8-i));
+	}
+	for (; i<length; i++) {
+		dp[i] = shiftDown(value,length-1-i) & 0x01;
 	}
 }
 
@@ -129,11 +215,13 @@ void BitVector::fillField(size_t writeIndex, uint64_t value, unsigned length)
 void BitVector::fillFieldReversed(size_t writeIndex, uint64_t value, unsigned length)
 {
 	char *dp = mStart + writeIndex;
-	char *dpEnd = dp + length - 1;
-	assert(dpEnd < mEnd);
-	while (dp<=dpEnd) {
-		*dp++ = value & 0x01;
-		value >>= 1;
+	assert(dp+length <= mEnd);
+	unsigned i = 0;
+	for (; i+8<=length; i+=8) {
+		scatterLSB8(dp+i,shiftDown(value,i));
+	}
+	for (; i<length; i++) {
+		dp[i] = shiftDown(value,i) & 0x01;
 	}
 }
 
@@ -156,33 +244,45 @@ void BitVector::writeFieldReversed(size_t& writeIndex, uint64_t value, unsigned
 
 void BitVector::invert()
 {
-	for (size_t i=0; i<size(); i++) {
+	size_t i = 0;
+	for (; i+8<=size(); i+=8) {
+		storeBits(mStart+i,~loadBits(mStart+i));
+	}
+	for (; i<size(); i++) {
 		mStart[i] = ~mStart[i];
 	}
 }
 
 
+void BitVector::xorWith(const BitVector& other)
+{
+	assert(other.size()==size());
+	size_t i = 0;
+	for (; i+8<=size(); i+=8) {
+		storeBits(mStart+i,loadBits(mStart+i) ^ loadBits(other.mStart+i));
+	}
+	for (; i<size(); i++) {
+		mStart[i] ^= other.mStart[i];
+	}
+}
 
 
-void BitVector::reverse8()
-{
-	assert(size()>=8);
 
-	char tmp0 = mStart[0];
-	mStart[0] = mStart[7];
-	mStart[7] = tmp0;
 
-	char tmp1 = mStart[1];
-	mStart[1] = mStart[6];
-	mStart[6] = tmp1;
+/** Reverse the order of 8 bit bytes. */
+static inline void reverseBits8(char *dp)
+{
+	const uint64_t word = loadBits(dp);
+	uint64_t reversed = 0;
+	for (unsigned i=0; i<8; i++) reversed |= ((word>>(8*i)) & 0xff) << (8*(7-i));
+	storeBits(dp,reversed);
+}
 
-	char tmp2 = mStart[2];
-	mStart[2] = mStart[5];
-	mStart[5] = tmp2;
 
-	char tmp3 = mStart[3];
-	mStart[3] = mStart[4];
-	mStart[4] = tmp3;
+void BitVector::reverse8()
+{
+	assert(size()>=8);
+	reverseBits8(mStart);
 }
 
 
@@ -191,8 +291,7 @@ void BitVector::LSB8MSB()
 {
 	if (size()<8) return;
 	size_t size8 = 8*(size()/8);
-	size_t iTop = size8 - 8;
-	for (size_t i=0; i<=iTop; i+=8) segment(i,8).reverse8();
+	for (size_t i=0; i<size8; i+=8) reverseBits8(mStart+i);
 }
 
 
@@ -215,6 +314,18 @@ uint64_t BitVector::parity(Generator& gen) const
 }
 
 
+uint64_t BitVector::syndrome(const Parity& coder) const
+{
+	return coder.syndrome(*this);
+}
+
+
+uint64_t BitVector::parity(const Parity& coder) const
+{
+	return coder.parity(*this);
+}
+
+
 void BitVector::encode(const ViterbiR2O4& coder, BitVector& target)
 {
 	size_t sz = size();
@@ -243,7 +354,12 @@ void BitVector::encode(const ViterbiR2O4& coder, BitVector& target)
 unsigned BitVector::sum() const
 {
 	unsigned sum = 0;
-	for (size_t i=0; i<size(); i++) sum += mStart[i] & 0x01;
+	size_t i = 0;
+	for (; i+8<=size(); i+=8) {
+		// at most 8 in any byte, so the bytes add up without carries
+		sum += ((loadBits(mStart+i) & sLowBits) * sLowBits) >> 56;
+	}
+	for (; i<size(); i++) sum += mStart[i] & 0x01;
 	return sum;
 }
 
@@ -296,6 +412,7 @@ ViterbiR2O4::ViterbiR2O4()
 	computeStateTables(0);
 	computeStateTables(1);
 	computeGeneratorTable();
+	computeOutputMasks();
 }
 
 
@@ -329,6 +446,21 @@ void ViterbiR2O4::computeGeneratorTable()
 	}
 }
 
+void ViterbiR2O4::computeOutputMasks()
+{
+	// Once the survivors sit at their trellis positions, candidate i extends
+	// survivor i/2 and candidate i+mIStates extends survivor i/2+mIStates/2,
+	// both with input i&1, so their outputs are fixed.
+	for (unsigned half=0; half<2; half++) {
+		for (unsigned out=0; out<(1U<<mIRate); out++) {
+			for (unsigned i=0; i<mIStates; i++) {
+				bool hit = mGeneratorTable[half*mIStates + i] == out;
+				mOutputMask[half][out][i] = hit ? 0xffffffff : 0;
+			}
+		}
+	}
+}
+
 
 
 
@@ -403,9 +535,244 @@ const ViterbiR2O4::vCand& ViterbiR2O4::step(uint32_t inSample, const float *prob
 }
 
 
-uint64_t Parity::syndrome(const BitVector& receivedCodeword)
+/**
+	Costs of the four output pairs at a given step of decode().
+	These are the same float sums getSoftCostMetrics() makes from the
+	sliced history and cost tables, including the padding past the end.
+*/
+static inline void viterbiBranchCosts(const float *soft, size_t sz, size_t step, float *branchCost)
+{
+	float cost[2][2];		// [symbol of the pair][mismatched]
+	unsigned inSample = 0;
+	for (unsigned j=0; j<2; j++) {
+		const size_t n = 2*step + j;
+		if (n<sz) {
+			// pVal is the probability that a bit is correct.
+			// ipVal is the probability that a bit is incorrect.
+			float pVal = soft[n];
+			inSample = (inSample<<1) | (pVal>0.5F);
+			if (pVal>0.5F) pVal = 1.0F-pVal;
+			float ipVal = 1.0F-pVal;
+			if (pVal<0.01F) pVal = 0.01;
+			if (ipVal<0.01F) ipVal = 0.01;
+			cost[j][0] = 0.25F/ipVal;
+			cost[j][1] = 0.25F/pVal;
+		} else {
+			// past the end, repeat the last bit as an unknown
+			inSample = (inSample<<1) | (sz>0 && soft[sz-1]>0.5F);
+			cost[j][0] = 0.5F;
+			cost[j][1] = 0.5F;
+		}
+	}
+	for (unsigned out=0; out<4; out++) {
+		const unsigned mismatched = inSample ^ out;
+		branchCost[out] = cost[1][mismatched&0x01] + cost[0][(mismatched>>1)&0x01];
+	}
+}
+
+
+unsigned ViterbiR2O4::addCompareSelect(const float *branchCost)
+{
+	// Works from the actual survivor histories, so it is also right for the
+	// first steps, before the survivors reach their trellis positions.
+	float cost[mIStates];
+	uint32_t path[mIStates];
+	for (unsigned i=0; i<mIStates; i++) {
+		const unsigned s1 = i>>1;
+		const unsigned s2 = s1 + mIStates/2;
+		const uint32_t p1 = (mPath[s1]<<1) | (i&0x01);
+		const uint32_t p2 = (mPath[s2]<<1) | (i&0x01);
+		const float c1 = mCost[s1] + branchCost[mGeneratorTable[p1 & mCMask]];
+		const float c2 = mCost[s2] + branchCost[mGeneratorTable[p2 & mCMask]];
+		if (c1 < c2) { cost[i] = c1; path[i] = p1; }
+		else { cost[i] = c2; path[i] = p2; }
+	}
+	unsigned best = 0;
+	for (unsigned i=0; i<mIStates; i++) {
+		mCost[i] = cost[i];
+		mPath[i] = path[i];
+		if (cost[i] < cost[best]) best = i;
+	}
+	return best;
+}
+
+
+#ifdef HAVE_X86_VITERBI
+/** Survivor costs of one group of four trellis positions. */
+__attribute__((target("sse2")))
+static inline __m128 viterbiSelectCosts(const uint32_t (*mask)[16], unsigned group, const __m128 *branch)
+{
+	const float *m0 = (const float *)&mask[0][4*group];
+	const float *m1 = (const float *)&mask[1][4*group];
+	const float *m2 = (const float *)&mask[2][4*group];
+	const float *m3 = (const float *)&mask[3][4*group];
+	return _mm_or_ps(_mm_or_ps(_mm_and_ps(_mm_loadu_ps(m0),branch[0]),_mm_and_ps(_mm_loadu_ps(m1),branch[1])),
+			 _mm_or_ps(_mm_and_ps(_mm_loadu_ps(m2),branch[2]),_mm_and_ps(_mm_loadu_ps(m3),branch[3])));
+}
+
+/**
+	The decode() loop for steps where every survivor sits at its trellis position.
+	Sixteen float costs and 32-bit paths are held four to a register, and the
+	compares and ties resolve exactly as in the scalar code.
+*/
+__attribute__((target("sse2")))
+static void viterbiSSE2(const float *soft, size_t sz, size_t step, size_t steps,
+			float *survivorCost, uint32_t *survivorPath,
+			const uint32_t (*outputMask)[4][16], unsigned deferral, char *out)
+{
+	__m128 cost[4];
+	__m128i path[4];
+	for (unsigned r=0; r<4; r++) {
+		cost[r] = _mm_loadu_ps(survivorCost + 4*r);
+		path[r] = _mm_loadu_si128((const __m128i *)(survivorPath + 4*r));
+	}
+	const __m128i oddInput = _mm_set_epi32(1,0,1,0);
+
+	for (; step<steps; step++) {
+		float branchCost[4];
+		viterbiBranchCosts(soft,sz,step,branchCost);
+		__m128 branch[4];
+		for (unsigned o=0; o<4; o++) branch[o] = _mm_set1_ps(branchCost[o]);
+
+		__m128 newCost[4];
+		__m128i newPath[4];
+		for (unsigned r=0; r<4; r++) {
+			// positions 4r..4r+3 extend survivors 2r,2r,2r+1,2r+1 and those +8
+			__m128 c1, c2;
+			__m128i p1, p2;
+			if (r & 0x01) {
+				c1 = _mm_unpackhi_ps(cost[r>>1],cost[r>>1]);
+				c2 = _mm_unpackhi_ps(cost[2+(r>>1)],cost[2+(r>>1)]);
+				p1 = _mm_unpackhi_epi32(path[r>>1],path[r>>1]);
+				p2 = _mm_unpackhi_epi32(path[2+(r>>1)],path[2+(r>>1)]);
+			} else {
+				c1 = _mm_unpacklo_ps(cost[r>>1],cost[r>>1]);
+				c2 = _mm_unpacklo_ps(cost[2+(r>>1)],cost[2+(r>>1)]);
+				p1 = _mm_unpacklo_epi32(path[r>>1],path[r>>1]);
+				p2 = _mm_unpacklo_epi32(path[2+(r>>1)],path[2+(r>>1)]);
+			}
+			c1 = _mm_add_ps(c1,viterbiSelectCosts(outputMask[0],r,branch));
+			c2 = _mm_add_ps(c2,viterbiSelectCosts(outputMask[1],r,branch));
+			p1 = _mm_or_si128(_mm_slli_epi32(p1,1),oddInput);
+			p2 = _mm_or_si128(_mm_slli_epi32(p2,1),oddInput);
+			const __m128 first = _mm_cmplt_ps(c1,c2);
+			const __m128i firsti = _mm_castps_si128(first);
+			newCost[r] = _mm_or_ps(_mm_and_ps(first,c1),_mm_andnot_ps(first,c2));
+			newPath[r] = _mm_or_si128(_mm_and_si128(firsti,p1),_mm_andnot_si128(firsti,p2));
+		}
+		for (unsigned r=0; r<4; r++) {
+			cost[r] = newCost[r];
+			path[r] = newPath[r];
+		}
+
+		if (step < deferral) continue;
+
+		// lowest cost, first position on ties
+		__m128 least = _mm_min_ps(_mm_min_ps(cost[0],cost[1]),_mm_min_ps(cost[2],cost[3]));
+		least = _mm_min_ps(least,_mm_shuffle_ps(least,least,_MM_SHUFFLE(1,0,3,2)));
+		least = _mm_min_ps(least,_mm_shuffle_ps(least,least,_MM_SHUFFLE(2,3,0,1)));
+		unsigned hits = 0;
+		for (unsigned r=0; r<4; r++)
+			hits |= _mm_movemask_ps(_mm_cmpeq_ps(cost[r],least)) << (4*r);
+		uint32_t paths[16];
+		for (unsigned r=0; r<4; r++)
+			_mm_storeu_si128((__m128i *)(paths + 4*r),path[r]);
+		*out++ = (paths[__builtin_ctz(hits)] >> deferral) & 0x01;
+	}
+
+	for (unsigned r=0; r<4; r++) {
+		_mm_storeu_ps(survivorCost + 4*r,cost[r]);
+		_mm_storeu_si128((__m128i *)(survivorPath + 4*r),path[r]);
+	}
+}
+
+static bool viterbiHaveSSE2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+static const bool sViterbiSSE2 = viterbiHaveSSE2();
+#endif
+
+
+void ViterbiR2O4::decode(const float *soft, size_t sz, char *out, size_t outSize)
+{
+	// One step per output bit, plus the deferral.
+	const size_t steps = outSize + mDeferral;
+	assert(sz <= mIRate*outSize);
+
+	// All survivors start out equal, as in initializeStates().
+	for (unsigned i=0; i<mIStates; i++) {
+		mCost[i] = 0.0F;
+		mPath[i] = 0;
+	}
+
+	size_t step = 0;
+	float branchCost[4];
+#ifdef HAVE_X86_VITERBI
+	// The survivors reach their trellis positions after mOrder steps.
+	if (sViterbiSSE2) {
+		for (; step<mOrder && step<steps; step++) {
+			viterbiBranchCosts(soft,sz,step,branchCost);
+			const unsigned best = addCompareSelect(branchCost);
+			if (step >= mDeferral) *out++ = (mPath[best] >> mDeferral) & 0x01;
+		}
+		viterbiSSE2(soft,sz,step,steps,mCost,mPath,mOutputMask,mDeferral,out);
+		return;
+	}
+#endif
+	for (; step<steps; step++) {
+		viterbiBranchCosts(soft,sz,step,branchCost);
+		const unsigned best = addCompareSelect(branchCost);
+		if (step >= mDeferral) *out++ = (mPath[best] >> mDeferral) & 0x01;
+	}
+}
+
+
+void Parity::computeByteTable()
+{
+	for (unsigned byte=0; byte<256; byte++) {
+		clear();
+		for (int i=7; i>=0; i--) encoderShift(byte>>i);
+		mByteTable[byte] = state();
+	}
+	clear();
+}
+
+
+uint64_t Parity::parity(const BitVector& data) const
+{
+	// An MSB-first CRC. The register XORs into the next input bits,
+	// so each byte goes through the table with the top of the register.
+	uint64_t accum = 0;
+	const char *dp = data.begin();
+	const char *end = data.end();
+	for (; dp+8<=end; dp+=8) {
+		const unsigned byte = gatherMSB8(dp);
+		if (mLen>=8) {
+			const unsigned index = ((accum >> (mLen-8)) ^ byte) & 0xff;
+			accum = ((accum<<8) & mMask) ^ mByteTable[index];
+		} else {
+			accum = mByteTable[((accum << (8-mLen)) ^ byte) & 0xff];
+		}
+	}
+	for (; dp<end; dp++) {
+		const unsigned fb = ((accum>>(mLen_1)) ^ *dp) & 0x01;
+		accum <<= 1;
+		if (fb) accum ^= mCoeff;
+	}
+	return accum & mMask;
+}
+
+
+uint64_t Parity::syndrome(const BitVector& receivedCodeword) const
 {
-	return receivedCodeword.syndrome(*this);
+	// The division remainder of d:p is the parity of d plus p.
+	const size_t sz = receivedCodeword.size();
+	const size_t split = (sz>mLen) ? sz-mLen : 0;
+	const uint64_t rem = receivedCodeword.peekField(split,sz-split);
+	return parity(receivedCodeword.head(split)) ^ rem;
 }
 
 
@@ -449,79 +816,8 @@ BitVector SoftVector::sliced() const
 
 void SoftVector::decode(ViterbiR2O4 &decoder, BitVector& target) const
 {
-	const size_t sz = size();
-	const unsigned deferral = decoder.deferral();
-	const size_t ctsz = sz + deferral*decoder.iRate();
-	assert(sz <= decoder.iRate()*target.size());
-
-	// Build a "history" array where each element contains the full history.
-	uint32_t history[ctsz];
-	{
-		BitVector bits = sliced();
-		uint32_t accum = 0;
-		for (size_t i=0; i<sz; i++) {
-			accum = (accum<<1) | bits.bit(i);
-			history[i] = accum;
-		}
-		// Repeat last bit at the end.
-		for (size_t i=sz; i<ctsz; i++) {
-			accum = (accum<<1) | (accum & 0x01);
-			history[i] = accum;
-		}
-	}
-
-	// Precompute metric tables.
-	float matchCostTable[ctsz];
-	float mismatchCostTable[ctsz];
-	{
-		const float *dp = mStart;
-		for (size_t i=0; i<sz; i++) {
-			// pVal is the probability that a bit is correct.
-			// ipVal is the probability that a bit is incorrect.
-			float pVal = dp[i];
-			if (pVal>0.5F) pVal = 1.0F-pVal;
-			float ipVal = 1.0F-pVal;
-			// This is a cheap approximation to an ideal cost function.
-			if (pVal<0.01F) pVal = 0.01;
-			if (ipVal<0.01F) ipVal = 0.01;
-			matchCostTable[i] = 0.25F/ipVal;
-			mismatchCostTable[i] = 0.25F/pVal;
-		}
-	
-		// pad end of table with unknowns
-		for (size_t i=sz; i<ctsz; i++) {
-			matchCostTable[i] = 0.5F;
-			mismatchCostTable[i] = 0.5F;
-		}
-	}
-
-	{
-		decoder.initializeStates();
-		// Each sample of history[] carries its history.
-		// So we only have to process every iRate-th sample.
-		const unsigned step = decoder.iRate();
-		// input pointer
-		const uint32_t *ip = history + step - 1;
-		// output pointers
-		char *op = target.begin();
-		const char *const opt = target.end();
-		// table pointers
-		const float* match = matchCostTable;
-		const float* mismatch = mismatchCostTable;
-		size_t oCount = 0;
-		while (op<opt) {
-			// Viterbi algorithm
-			assert(match-matchCostTable<sizeof(matchCostTable)/sizeof(matchCostTable[0])-1);
-			assert(mismatch-mismatchCostTable<sizeof(mismatchCostTable)/sizeof(mismatchCostTable[0])-1);
-			const ViterbiR2O4::vCand &minCost = decoder.step(*ip, match, mismatch);
-			ip += step;
-			match += step;
-			mismatch += step;
-			// output
-			if (oCount>=deferral) *op++ = (minCost.iState >> deferral)&0x01;
-			oCount++;
-		}
-	}
+	assert(size() <= decoder.iRate()*target.size());
+	decoder.decode(mStart,size(),target.begin(),target.size());
 }
 
 
@@ -544,7 +840,7 @@ void BitVector::pack(unsigned char* targ) const
 	// Assumes MSB-first packing.
 	unsigned bytes = size()/8;
 	for (unsigned i=0; i<bytes; i++) {
-		targ[i] = peekField(i*8,8);
+		targ[i] = gatherMSB8(mStart+i*8);
 	}
 	unsigned whole = bytes*8;
 	unsigned rem = size() - whole;
@@ -558,7 +854,7 @@ void BitVector::unpack(const unsigned char* src)
 	// Assumes MSB-first packing.
 	unsigned bytes = size()/8;
 	for (unsigned i=0; i<bytes; i++) {
-		fillField(i*8,src[i],8);
+		scatterMSB8(mStart+i*8,src[i]);
 	}
 	unsigned whole = bytes*8;
 	unsigned rem = size() - whole;
@@ -38,7 +38,7 @@ class SoftVector;
 /** Shift-register (LFSR) generator. */
 class Generator {
 
-	private:
+	protected:
 
 	uint64_t mCoeff;	///< polynomial coefficients. LSB is zero exponent.
 	uint64_t mState;	///< shift register state. LSB is most recent.
@@ -96,19 +96,31 @@ class Parity : public Generator {
 	protected:
 
 	unsigned mCodewordSize;
+	uint64_t mByteTable[256];	///< register after shifting in each byte from clear
 
 	public:
 
 	Parity(uint64_t wCoefficients, unsigned wParitySize, unsigned wCodewordSize)
 		:Generator(wCoefficients, wParitySize),
 		mCodewordSize(wCodewordSize)
-	{ }
+	{ computeByteTable(); }
 
 	/** Compute the parity word and write it into the target segment.  */
 	void writeParityWord(const BitVector& data, BitVector& parityWordTarget, bool invert=true);
 
-	/** Compute the syndrome of a received sequence. */
-	uint64_t syndrome(const BitVector& receivedCodeword);
+	/**
+		Compute the syndrome of a received sequence.
+		This is the parity of all but the last size() bits, XORed with those bits.
+	*/
+	uint64_t syndrome(const BitVector& receivedCodeword) const;
+
+	/** Compute the parity word of a sequence, a byte at a time. */
+	uint64_t parity(const BitVector& data) const;
+
+	private:
+
+	/** Precompute the register contents for each input byte. */
+	void computeByteTable();
 };
 
 
@@ -144,6 +156,13 @@ class ViterbiR2O4 {
 		uint32_t mCoeffs[mIRate];					///< polynomial for each generator
 		uint32_t mStateTable[mIRate][2*mIStates];	///< precomputed generator output tables
 		uint32_t mGeneratorTable[2*mIStates];		///< precomputed coder output table
+		uint32_t mOutputMask[2][1<<mIRate][mIStates];	///< all ones where candidate i (0) or i+mIStates (1) emits each output
+		//@}
+
+		/**@name Survivors of decode(), by trellis position. */
+		//@{
+		float mCost[mIStates];				///< cost of each survivor
+		uint32_t mPath[mIStates];			///< input history of each survivor
 		//@}
 	
 	public:
@@ -194,8 +213,20 @@ class ViterbiR2O4 {
 		*/
 		const vCand& step(uint32_t inSample, const float *probs, const float *iprobs);
 
+		/**
+			Decode soft symbols, each the probability that a bit is 1.
+			Makes the same decisions as step() run over the sliced history,
+			but keeps the survivors in place and vectorizes the add-compare-select.
+			@param soft sz soft symbols
+			@param out outSize decoded bits
+		*/
+		void decode(const float *soft, size_t sz, char *out, size_t outSize);
+
 	private:
 
+		/** Add-compare-select over the decode() survivors, returns the index of the best one. */
+		unsigned addCompareSelect(const float *branchCost);
+
 		/** Branch survivors into new candidates. */
 		void branchCandidates();
 
@@ -220,6 +251,9 @@ class ViterbiR2O4 {
 		*/
 		void computeGeneratorTable();
 
+		/** Precompute the output masks for vectorized decoding. */
+		void computeOutputMasks();
+
 };
 
 
@@ -288,6 +322,10 @@ class BitVector : public Vector<char> {
 	uint64_t syndrome(Generator& gen) const;
 	/** Calculate the parity word for the vector with the given Generator. */
 	uint64_t parity(Generator& gen) const;
+	/** Calculate the syndrome with the byte tables of a Parity. */
+	uint64_t syndrome(const Parity& coder) const;
+	/** Calculate the parity word with the byte tables of a Parity. */
+	uint64_t parity(const Parity& coder) const;
 	/** Encode the signal with the GSM rate 1/2 convolutional encoder. */
 	void encode(const ViterbiR2O4& encoder, BitVector& target);
 	//@}
@@ -296,6 +334,9 @@ class BitVector : public Vector<char> {
 	/** Invert 0<->1. */
 	void invert();
 
+	/** XOR another vector of the same size into this one. */
+	void xorWith(const BitVector& other);
+
 	/**@name Byte-wise operations. */
 	//@{
 	/** Reverse an 8-bit vector. */
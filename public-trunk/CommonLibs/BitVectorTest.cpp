@@ -32,6 +32,42 @@
 using namespace std;
 
 
+// Decode one step at a time, as SoftVector::decode used to.
+void stepDecode(const SoftVector& in, ViterbiR2O4& decoder, BitVector& target)
+{
+	const size_t sz = in.size();
+	const unsigned deferral = decoder.deferral();
+	const size_t ctsz = sz + deferral*decoder.iRate();
+	uint32_t history[ctsz];
+	float match[ctsz];
+	float mismatch[ctsz];
+	uint32_t accum = 0;
+	for (size_t i=0; i<ctsz; i++) {
+		if (i<sz) {
+			accum = (accum<<1) | (in[i]>0.5F);
+			float pVal = in[i];
+			if (pVal>0.5F) pVal = 1.0F-pVal;
+			float ipVal = 1.0F-pVal;
+			if (pVal<0.01F) pVal = 0.01;
+			if (ipVal<0.01F) ipVal = 0.01;
+			match[i] = 0.25F/ipVal;
+			mismatch[i] = 0.25F/pVal;
+		} else {
+			accum = (accum<<1) | (accum & 0x01);
+			match[i] = 0.5F;
+			mismatch[i] = 0.5F;
+		}
+		history[i] = accum;
+	}
+	decoder.initializeStates();
+	const unsigned step = decoder.iRate();
+	for (size_t k=0; k<target.size()+deferral; k++) {
+		const ViterbiR2O4::vCand& minCost = decoder.step(history[k*step+step-1], match+k*step, mismatch+k*step);
+		if (k>=deferral) target[k-deferral] = (minCost.iState >> deferral)&0x01;
+	}
+}
+
+
 int main(int argc, char *argv[])
 {
 	BitVector v1("0000111100111100101011110000");
@@ -69,6 +105,10 @@ int main(int argc, char *argv[])
 	v5.reverse8();
 	cout << v5 << endl;
 
+	BitVector v6("0101010101010101010101");
+	v6.xorWith(BitVector(v5.head(8),BitVector("11111111111111")));
+	cout << v6 << endl;
+
 	BitVector mC = "000000000000111100000000000001110000011100001101000011000000000000000111000011110000100100001010000010100000101000001010000010100000010000000000000000000000000000000000000000000000001100001111000000000000000000000000000000000000000000000000000010010000101000001010000010100000101000001010000001000000000000000000000000110000111100000000000001110000101000001100000001000000000000";
 	SoftVector mCS(mC);
 	BitVector mU(mC.size()/2);
@@ -76,6 +116,37 @@ int main(int argc, char *argv[])
 	cout << "c=" << mCS << endl;
 	cout << "u=" << mU << endl;
 
+	// decode() must make exactly the decisions of step()
+	unsigned mismatches = 0;
+	const unsigned lengths[] = {456, 378, 36, 57, 1};
+	for (unsigned t=0; t<100; t++) {
+		const unsigned len = lengths[t%5];
+		SoftVector sv(len);
+		for (unsigned i=0; i<len; i++) {
+			switch (random()%4) {
+				case 0: sv[i] = 0.0F; break;
+				case 1: sv[i] = 1.0F; break;
+				case 2: sv[i] = 0.5F; break;
+				default: sv[i] = (random()%1001)/1000.0F;
+			}
+		}
+		BitVector fast((len+1)/2);
+		BitVector slow((len+1)/2);
+		sv.decode(vCoder,fast);
+		stepDecode(sv,vCoder,slow);
+		for (unsigned i=0; i<fast.size(); i++) mismatches += fast.bit(i)!=slow.bit(i);
+	}
+	cout << "viterbi mismatches=" << mismatches << endl;
+
+	// byte tables against the bit-serial generator, for the xCCH Fire code
+	Parity fire(0x10004820009ULL,40,224);
+	BitVector cw(224+40);
+	for (unsigned i=0; i<cw.size(); i++) cw[i] = random()&0x01;
+	BitVector cwP = cw.tail(224);
+	fire.writeParityWord(cw.head(224),cwP);
+	cwP.invert();
+	cout << "fire syndrome=" << fire.syndrome(cw) << " bitwise=" << cw.syndrome((Generator&)fire) << endl;
+
 
 	unsigned char ts[9] = "abcdefgh";
 	BitVector tp(70);
@@ -0,0 +1,211 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "ShmSocket.h"
+
+
+#define SHM_MAGIC 0x4f425453	// "OBTS"
+
+
+/** The shared memory object, one ring per direction. */
+struct ShmSegment {
+	uint32_t magic;
+	uint32_t size;
+	ShmRing ring[2];				///< ring 0 is written by the creator
+};
+
+
+static uint64_t monotonicMicros()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (uint64_t)now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+
+
+ShmSocket::ShmSocket(const char* name, bool creator)
+	:mCreator(creator),mSegment(NULL),mRx(NULL),mTx(NULL),mLastStamp(0)
+{
+	strncpy(mName,name,sizeof(mName)-1);
+	mName[sizeof(mName)-1] = '\0';
+
+	int fd;
+	if (creator) {
+		// Start clean, a segment left by an earlier run may hold stale packets.
+		shm_unlink(mName);
+		fd = shm_open(mName,O_RDWR|O_CREAT|O_EXCL,0600);
+		if (fd>=0 && ftruncate(fd,sizeof(ShmSegment))<0) {
+			perror("ShmSocket ftruncate() failed");
+			::close(fd);
+			fd = -1;
+		}
+	} else {
+		fd = shm_open(mName,O_RDWR,0);
+	}
+	if (fd<0) {
+		perror("ShmSocket shm_open() failed");
+		return;
+	}
+
+	void *map = mmap(NULL,sizeof(ShmSegment),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	::close(fd);
+	if (map==MAP_FAILED) {
+		perror("ShmSocket mmap() failed");
+		return;
+	}
+	ShmSegment *segment = (ShmSegment*)map;
+
+	// A new object is zero-filled, which is two empty rings.
+	if (creator) {
+		segment->size = sizeof(ShmSegment);
+		__sync_synchronize();
+		segment->magic = SHM_MAGIC;
+	} else if (segment->magic!=SHM_MAGIC || segment->size!=sizeof(ShmSegment)) {
+		fprintf(stderr,"ShmSocket %s has the wrong format\n",mName);
+		munmap(map,sizeof(ShmSegment));
+		return;
+	}
+
+	mSegment = segment;
+	mTx = &segment->ring[creator ? 0 : 1];
+	mRx = &segment->ring[creator ? 1 : 0];
+}
+
+
+ShmSocket::~ShmSocket()
+{
+	if (mSegment) munmap(mSegment,sizeof(ShmSegment));
+	if (mCreator) shm_unlink(mName);
+}
+
+
+
+int ShmSocket::write(const char* buffer, size_t length)
+{
+	assert(length<=MAX_UDP_LENGTH);
+	if (!mSegment) return -1;
+
+	uint32_t head = mTx->mHead;
+	if (head - mTx->mTail >= SHM_RING_SLOTS) return -1;
+
+	ShmSlot &slot = mTx->mSlots[head % SHM_RING_SLOTS];
+	memcpy(slot.data,buffer,length);
+	slot.length = length;
+	slot.stamp = monotonicMicros();
+
+	// Publish the packet, then wake the reader only if it went to sleep.
+	// The barrier pairs with the one in wait(), so that either the reader
+	// sees the new head or we see its waiting flag.
+	__sync_synchronize();
+	mTx->mHead = head+1;
+	__sync_synchronize();
+	if (mTx->mWaiting) {
+		mTx->mWaiting = 0;
+		syscall(SYS_futex,&mTx->mHead,FUTEX_WAKE,1,NULL,NULL,0);
+	}
+	return length;
+}
+
+
+int ShmSocket::write(const char* buffer)
+{
+	size_t length=strlen(buffer)+1;
+	return write(buffer,length);
+}
+
+
+bool ShmSocket::wait(int timeout)
+{
+	struct timespec ts;
+	struct timespec *tsp = NULL;
+	// Wakeups can come early, so each sleep is for what is left of the timeout.
+	uint64_t deadline = 0;
+	if (timeout>=0) {
+		deadline = monotonicMicros() + (uint64_t)timeout*1000;
+		tsp = &ts;
+	}
+
+	while (true) {
+		uint32_t head = mRx->mHead;
+		if (head!=mRx->mTail) return true;
+		if (tsp) {
+			uint64_t now = monotonicMicros();
+			if (now>=deadline) return false;
+			ts.tv_sec = (deadline-now)/1000000;
+			ts.tv_nsec = ((deadline-now)%1000000)*1000;
+		}
+		mRx->mWaiting = 1;
+		__sync_synchronize();
+		if (mRx->mHead!=mRx->mTail) return true;
+		// The kernel only sleeps if mHead still has the value we saw.
+		int rc = syscall(SYS_futex,&mRx->mHead,FUTEX_WAIT,head,tsp,NULL,0);
+		if (rc<0 && errno==ETIMEDOUT) return mRx->mHead!=mRx->mTail;
+	}
+}
+
+
+int ShmSocket::read(char* buffer)
+{
+	if (!mSegment) return -1;
+	wait(-1);
+	uint32_t tail = mRx->mTail;
+	__sync_synchronize();
+	const ShmSlot &slot = mRx->mSlots[tail % SHM_RING_SLOTS];
+	int length = slot.length;
+	memcpy(buffer,slot.data,length);
+	mLastStamp = slot.stamp;
+	__sync_synchronize();
+	mRx->mTail = tail+1;
+	return length;
+}
+
+
+int ShmSocket::read(char* buffer, unsigned timeout)
+{
+	if (!mSegment) return -1;
+	if (!wait(timeout)) return -1;
+	return read(buffer);
+}
+
+
+long ShmSocket::lastDelay() const
+{
+	return (long)(monotonicMicros() - mLastStamp);
+}
+
+
+// vim: ts=4 sw=4
@@ -0,0 +1,132 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef SHMSOCKET_H
+#define SHMSOCKET_H
+
+#include <stdint.h>
+#include "Sockets.h"
+
+
+/** Number of packets each direction of a ShmSocket can hold. */
+#define SHM_RING_SLOTS 64
+
+
+/** One packet in a shared memory ring. */
+struct ShmSlot {
+	uint32_t length;				///< packet length in bytes
+	uint32_t pad;
+	uint64_t stamp;					///< time of writing, microseconds of CLOCK_MONOTONIC
+	char data[MAX_UDP_LENGTH];
+};
+
+
+/**
+	One direction of a ShmSocket, a single-producer single-consumer ring.
+	The counters are on their own cache lines, the reader sleeps on mHead with a futex.
+*/
+struct ShmRing {
+	volatile uint32_t mHead;		///< packets written, owned by the writer
+	char mPad1[60];
+	volatile uint32_t mTail;		///< packets read, owned by the reader
+	volatile uint32_t mWaiting;		///< set by a reader about to sleep
+	char mPad2[56];
+	ShmSlot mSlots[SHM_RING_SLOTS];
+};
+
+
+/**
+	A datagram channel through POSIX shared memory, for two processes on the same host.
+	It has the read and write calls of a DatagramSocket, so it can carry the
+	TRX data interface in place of a UDPSocket without the network stack.
+	Each end has one reader thread and one writer thread at most.
+	A packet written to a full ring is dropped, as UDP would.
+*/
+class ShmSocket {
+
+	private:
+
+	char mName[256];				///< POSIX shared memory object name
+	bool mCreator;					///< true if this end created and will remove the object
+	struct ShmSegment *mSegment;	///< the mapped segment, or NULL
+	ShmRing *mRx;					///< ring this end reads
+	ShmRing *mTx;					///< ring this end writes
+	uint64_t mLastStamp;			///< write time of the most recently read packet
+
+	public:
+
+	/**
+		Create or attach a shared memory channel.
+		@param name The POSIX shared memory object name, like "/OpenBTS.TRX.5702".
+		@param creator True on the end that creates the object, false on the end that attaches.
+	*/
+	ShmSocket(const char* name, bool creator);
+
+	~ShmSocket();
+
+	/** Return true if the segment is mapped and usable. */
+	bool valid() const { return mSegment!=NULL; }
+
+	/**
+		Send a binary packet.
+		@return number of bytes written, or -1 if the ring is full.
+	*/
+	int write(const char* buffer, size_t length);
+
+	/**
+		Send a C-style string packet.
+		@return number of bytes written, or -1 if the ring is full.
+	*/
+	int write(const char* buffer);
+
+	/**
+		Receive a packet, waiting as long as needed.
+		@param buffer A char[MAX_UDP_LENGTH] procured by the caller.
+		@return The number of bytes received.
+	*/
+	int read(char* buffer);
+
+	/**
+		Receive a packet with a timeout.
+		@param buffer A char[MAX_UDP_LENGTH] procured by the caller.
+		@param timeout maximum wait time in milliseconds
+		@return The number of bytes received or -1 on timeout.
+	*/
+	int read(char* buffer, unsigned timeout);
+
+	/** Return the time in microseconds the most recently read packet spent in the ring. */
+	long lastDelay() const;
+
+	private:
+
+	/** Wait for a packet, forever if timeout is negative, return false on timeout. */
+	bool wait(int timeout);
+
+};
+
+#endif
+
+// vim: ts=4 sw=4
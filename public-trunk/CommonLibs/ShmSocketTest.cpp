@@ -0,0 +1,94 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ShmSocket.h"
+#include "Threads.h"
+#include "Timeval.h"
+
+
+static const int gNumToSend = 10000;
+
+
+void *testReader(void *)
+{
+	ShmSocket readSocket("/ShmSocketTest",false);
+	if (!readSocket.valid()) return NULL;
+	long maxDelay = 0;
+	long totalDelay = 0;
+	int bad = 0;
+	for (int i=0; i<gNumToSend; i++) {
+		char buf[MAX_UDP_LENGTH];
+		int count = readSocket.read(buf,1000);
+		if (count<0) {
+			COUT("timeout after " << i << " packets");
+			break;
+		}
+		int seq;
+		sscanf(buf,"packet %d",&seq);
+		if (seq!=i || count!=(int)strlen(buf)+1) bad++;
+		long delay = readSocket.lastDelay();
+		totalDelay += delay;
+		if (delay>maxDelay) maxDelay = delay;
+	}
+	COUT("read " << gNumToSend << " packets, " << bad << " bad, delay mean "
+		<< totalDelay/gNumToSend << " us max " << maxDelay << " us");
+	char buf[MAX_UDP_LENGTH];
+	Timeval start;
+	int count = readSocket.read(buf,10);
+	COUT("read on empty ring returns " << count << " after " << start.elapsed() << " ms");
+	return NULL;
+}
+
+
+int main(int argc, char * argv[] )
+{
+	ShmSocket writeSocket("/ShmSocketTest",true);
+	if (!writeSocket.valid()) return 1;
+
+	Thread readerThread;
+	readerThread.start(testReader,NULL);
+
+	int dropped = 0;
+	for (int i=0; i<gNumToSend; i++) {
+		char buf[MAX_UDP_LENGTH];
+		sprintf(buf,"packet %d",i);
+		// a full ring drops, so back off and retry
+		while (writeSocket.write(buf)<0) {
+			dropped++;
+			usleep(100);
+		}
+		if (i%100==0) usleep(1000);
+	}
+	COUT("sent " << gNumToSend << " packets, ring full " << dropped << " times");
+
+	readerThread.join();
+}
+
+// vim: ts=4 sw=4
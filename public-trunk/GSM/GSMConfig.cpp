@@ -49,6 +49,7 @@ void GSMConfig::start()
 	mPowerManager.start();
 	// Do not call this until the paging channels are installed.
 	mPager.start();
+	if (gConfig.defines("GSM.DecoderThreads")) mDecoderPool.start(gConfig.getNum("GSM.DecoderThreads"));
 }
 
 
@@ -317,6 +318,8 @@ void GSMConfig::createCombinationVII(TransceiverManager& TRX, unsigned CN, unsig
 	LOG(NOTICE) << "Configuring combination VII on C" << CN << "T" << TN;
 	ARFCNManager *radio = TRX.ARFCN(CN);
 	radio->setSlot(TN,7);
+	// SDCCH/8 signalling can get by with hard decisions, if so configured.
+	if (gConfig.defines("TRX.HardBitsC7")) radio->setRxFormat(TN,ARFCNManager::RX_HARD);
 	for (int i=0; i<8; i++) {
 		SDCCHLogicalChannel* chan = new SDCCHLogicalChannel(TN,gSDCCH8[i]);
 		chan->downstream(radio);
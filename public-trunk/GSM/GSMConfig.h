@@ -37,6 +37,7 @@
 #include "GSML3RRMessages.h"
 
 #include "TRXManager.h"
+#include "GSML1FEC.h"
 
 
 namespace GSM {
@@ -63,6 +64,8 @@ class GSMConfig {
 
 	PowerManager mPowerManager;
 
+	L1DecoderPool mDecoderPool;		///< threads to decode xCCH blocks
+
 	mutable Mutex mLock;						///< multithread access control
 
 	/**@name Groups of CCCH subchannels -- may intersect. */
@@ -138,6 +141,7 @@ class GSMConfig {
 	/**@name Accessors. */
 	//@{
 	Control::Pager& pager() { return mPager; }
+	L1DecoderPool& decoderPool() { return mDecoderPool; }
 	GSMBand band() const { return mBand; }
 	unsigned BCC() const { return mBCC; }
 	unsigned NCC() const { return mNCC; }
@@ -172,6 +172,42 @@ unsigned encodePower(int power)
 
 
 
+/**
+	Burst position j of each coded bit c[k] in the 456-bit block interleavers,
+	j = 2*((49*k) % 57) + ((k%8)/4), from GSM 05.03 4.1.4 and 3.1.3.
+	The burst is k%4 for the xCCHs and (k+blockOffset)%8 for TCH/FACCH.
+*/
+static const unsigned char interleaveIndex[456] =
+{
+	  0,  98,  82,  66,  51,  35,  19,   3, 100,  84,  68,  52,  37,  21,   5, 103,  86,  70,  54,
+	 38,  23,   7, 105,  89,  72,  56,  40,  24,   9, 107,  91,  75,  58,  42,  26,  10, 109,  93,
+	 77,  61,  44,  28,  12, 110,  95,  79,  63,  47,  30,  14, 112,  96,  81,  65,  49,  33,  16,
+	  0,  98,  82,  67,  51,  35,  19,   2, 100,  84,  68,  53,  37,  21,   5, 102,  86,  70,  54,
+	 39,  23,   7, 105,  88,  72,  56,  40,  25,   9, 107,  91,  74,  58,  42,  26,  11, 109,  93,
+	 77,  60,  44,  28,  12, 111,  95,  79,  63,  46,  30,  14, 112,  97,  81,  65,  49,  32,  16,
+	  0,  98,  83,  67,  51,  35,  18,   2, 100,  84,  69,  53,  37,  21,   4, 102,  86,  70,  55,
+	 39,  23,   7, 104,  88,  72,  56,  41,  25,   9, 107,  90,  74,  58,  42,  27,  11, 109,  93,
+	 76,  60,  44,  28,  13, 111,  95,  79,  62,  46,  30,  14, 113,  97,  81,  65,  48,  32,  16,
+	  0,  99,  83,  67,  51,  34,  18,   2, 100,  85,  69,  53,  37,  20,   4, 102,  86,  71,  55,
+	 39,  23,   6, 104,  88,  72,  57,  41,  25,   9, 106,  90,  74,  58,  43,  27,  11, 109,  92,
+	 76,  60,  44,  29,  13, 111,  95,  78,  62,  46,  30,  15, 113,  97,  81,  64,  48,  32,  16,
+	  1,  99,  83,  67,  50,  34,  18,   2, 101,  85,  69,  53,  36,  20,   4, 102,  87,  71,  55,
+	 39,  22,   6, 104,  88,  73,  57,  41,  25,   8, 106,  90,  74,  59,  43,  27,  11, 108,  92,
+	 76,  60,  45,  29,  13, 111,  94,  78,  62,  46,  31,  15, 113,  97,  80,  64,  48,  32,  17,
+	  1,  99,  83,  66,  50,  34,  18,   3, 101,  85,  69,  52,  36,  20,   4, 103,  87,  71,  55,
+	 38,  22,   6, 104,  89,  73,  57,  41,  24,   8, 106,  90,  75,  59,  43,  27,  10, 108,  92,
+	 76,  61,  45,  29,  13, 110,  94,  78,  62,  47,  31,  15, 113,  96,  80,  64,  48,  33,  17,
+	  1,  99,  82,  66,  50,  34,  19,   3, 101,  85,  68,  52,  36,  20,   5, 103,  87,  71,  54,
+	 38,  22,   6, 105,  89,  73,  57,  40,  24,   8, 106,  91,  75,  59,  43,  26,  10, 108,  92,
+	 77,  61,  45,  29,  12, 110,  94,  78,  63,  47,  31,  15, 112,  96,  80,  64,  49,  33,  17,
+	  1,  98,  82,  66,  50,  35,  19,   3, 101,  84,  68,  52,  36,  21,   5, 103,  87,  70,  54,
+	 38,  22,   7, 105,  89,  73,  56,  40,  24,   8, 107,  91,  75,  59,  42,  26,  10, 108,  93,
+	 77,  61,  45,  28,  12, 110,  94,  79,  63,  47,  31,  14, 112,  96,  80,  65,  49,  33,  17
+};
+
+
+
+
 
 /*
 	L1Encoder base class methods.
@@ -520,6 +556,60 @@ void RACHL1Decoder::writeLowSide(const RxBurst& burst)
 
 
 
+void L1DecoderPool::start(unsigned numThreads)
+{
+	mLock.lock();
+	if (mRunning || numThreads==0) {
+		mLock.unlock();
+		return;
+	}
+	for (unsigned i=0; i<numThreads; i++) {
+		Thread* thread = new Thread;
+		thread->start((void*(*)(void*))L1DecoderPoolServiceLoopAdapter,this);
+	}
+	mRunning = true;
+	mLock.unlock();
+	LOG(INFO) << "decoding xCCH blocks in " << numThreads << " threads";
+}
+
+
+bool L1DecoderPool::submit(XCCHL1Decoder* decoder)
+{
+	mLock.lock();
+	const bool running = mRunning;
+	if (running) {
+		mQ.put(decoder);
+		mSignal.signal();
+	}
+	mLock.unlock();
+	return running;
+}
+
+
+void L1DecoderPool::serviceLoop()
+{
+	while (true) {
+		mLock.lock();
+		XCCHL1Decoder* decoder = (XCCHL1Decoder*)mQ.get();
+		while (decoder==NULL) {
+			mSignal.wait(mLock);
+			decoder = (XCCHL1Decoder*)mQ.get();
+		}
+		mLock.unlock();
+		decoder->decodeBlock();
+	}
+}
+
+
+void *GSM::L1DecoderPoolServiceLoopAdapter(L1DecoderPool* pool)
+{
+	pool->serviceLoop();
+	return NULL;
+}
+
+
+
+
 XCCHL1Decoder::XCCHL1Decoder(
 		unsigned wTN,
 		const TDMAMapping& wMapping,
@@ -527,17 +617,39 @@ XCCHL1Decoder::XCCHL1Decoder(
 	:L1Decoder(wTN,wMapping,wParent),
 	mBlockCoder(0x10004820009ULL, 40, 224),
 	mC(456), mU(228),
-	mP(mU.segment(184,40)),mDP(mU.head(224)),mD(mU.head(184))
+	mP(mU.segment(184,40)),mDP(mU.head(224)),mD(mU.head(184)),
+	mBlockPending(false)
 {
 	for (int i=0; i<4; i++) {
 		mI[i] = SoftVector(114);
 		// Fill with zeros just to make Valgrind happy.
 		mI[i].fill(.0);
+		mBlockI[i] = SoftVector(114);
+		mBlockI[i].fill(.0);
 	}
 }
 
 
 
+void XCCHL1Decoder::open()
+{
+	mBlockLock.lock();
+	mBlockPending = false;
+	mBlockLock.unlock();
+	L1Decoder::open();
+}
+
+
+void XCCHL1Decoder::close()
+{
+	mBlockLock.lock();
+	mBlockPending = false;
+	mBlockLock.unlock();
+	L1Decoder::close();
+}
+
+
+
 void XCCHL1Decoder::writeLowSide(const RxBurst& inBurst)
 {
 	OBJLOG(DEEPDEBUG) <<"XCCHL1Decoder " << inBurst;
@@ -549,14 +661,57 @@ void XCCHL1Decoder::writeLowSide(const RxBurst& inBurst)
 	// Accept the burst into the deinterleaving buffer.
 	// Return true if we are ready to interleave.
 	if (!processBurst(inBurst)) return;
-	deinterleave();
-	if (decode()) {
-		countGoodFrame();
-		mD.LSB8MSB();
-		handleGoodFrame();
-	} else {
+	submitBlock();
+}
+
+
+void XCCHL1Decoder::submitBlock()
+{
+	mBlockLock.lock();
+	// If the last block is still queued, the pool is a whole block behind.
+	// The new block replaces it.
+	const bool queued = mBlockPending;
+	if (queued) {
+		OBJLOG(NOTICE) <<"XCCHL1Decoder dropping undecoded block from " << mBlockTime;
 		countBadFrame();
 	}
+	for (int B=0; B<4; B++) {
+		mI[B].copyTo(mBlockI[B]);
+		// Mark the i[][] bits as unknown now.
+		// This makes it possible for the soft decoder to work around
+		// a missing burst.
+		mI[B].fill(0.5F);
+	}
+	mBlockTime = mReadTime;
+	mBlockPending = true;
+	mBlockLock.unlock();
+
+	if (queued) return;
+	if (!gBTS.decoderPool().submit(this)) decodeBlock();
+}
+
+
+void XCCHL1Decoder::decodeBlock()
+{
+	// The lock keeps the decoding state consistent through handleGoodFrame.
+	mBlockLock.lock();
+	if (mBlockPending && !active()) {
+		// The channel closed while the block waited in the pool.
+		OBJLOG(DEBUG) <<"XCCHL1Decoder not active, dropping block from " << mBlockTime;
+		mBlockPending = false;
+	}
+	if (mBlockPending) {
+		mBlockPending = false;
+		deinterleave();
+		if (decode()) {
+			countGoodFrame();
+			mD.LSB8MSB();
+			handleGoodFrame();
+		} else {
+			countBadFrame();
+		}
+	}
+	mBlockLock.unlock();
 }
 
 
@@ -601,16 +756,12 @@ bool XCCHL1Decoder::processBurst(const RxBurst& inBurst)
 
 void XCCHL1Decoder::deinterleave()
 {
-	// Deinterleave i[][] to c[].
+	// Deinterleave the block i[][] to c[].
 	// This comes directly from GSM 05.03, 4.1.4.
-	for (int k=0; k<456; k++) {
-		int B = k%4;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mC[k] = mI[B][j];
-		// Mark this i[][] bit as unknown now.
-		// This makes it possible for the soft decoder to work around
-		// a missing burst.
-		mI[B][j] = 0.5F;
+	const float *ip[4] = { mBlockI[0].begin(), mBlockI[1].begin(), mBlockI[2].begin(), mBlockI[3].begin() };
+	float *cp = mC.begin();
+	for (int k=0; k<456; k+=4) {
+		for (int B=0; B<4; B++) cp[k+B] = ip[B][interleaveIndex[k+B]];
 	}
 }
 
@@ -660,7 +811,7 @@ void XCCHL1Decoder::handleGoodFrame()
 
 	if (mUpstream) {
 		// Send all bits to GSMTAP
-		gWriteGSMTAP(ARFCN(),TN(),mReadTime.FN(),
+		gWriteGSMTAP(ARFCN(),TN(),mBlockTime.FN(),
 		             typeAndOffset(),mMapping.repeatLength()>51,true,
 					 mD);
 		// Build an L2 frame and pass it up.
@@ -848,11 +999,11 @@ void XCCHL1Encoder::encode()
 
 void XCCHL1Encoder::interleave()
 {
-	// GSM 05.03, 4.1.4.  Verbatim.
-	for (int k=0; k<456; k++) {
-		int B = k%4;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mI[B][j] = mC[k];
+	// GSM 05.03, 4.1.4.
+	char *ip[4] = { mI[0].begin(), mI[1].begin(), mI[2].begin(), mI[3].begin() };
+	const char *cp = mC.begin();
+	for (int k=0; k<456; k+=4) {
+		for (int B=0; B<4; B++) ip[B][interleaveIndex[k+B]] = cp[k+B];
 	}
 }
 
@@ -1135,11 +1286,16 @@ bool TCHFACCHL1Decoder::processBurst( const RxBurst& inBurst)
 void TCHFACCHL1Decoder::deinterleave(int blockOffset )
 {
 	OBJLOG(DEEPDEBUG) <<"TCHFACCHL1Decoder blockOffset=" << blockOffset;
-	for (int k=0; k<456; k++) {
-		int B = ( k + blockOffset ) % 8;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mC[k] = mI[B][j];
-		mI[B][j] = 0.5F;
+	// Burst pointers in the order bits k, k+1, ... k+7 use them.
+	float *ip[8];
+	for (int b=0; b<8; b++) ip[b] = mI[(b+blockOffset)%8].begin();
+	float *cp = mC.begin();
+	for (int k=0; k<456; k+=8) {
+		for (int b=0; b<8; b++) {
+			float *bit = ip[b] + interleaveIndex[k+b];
+			cp[k+b] = *bit;
+			*bit = 0.5F;
+		}
 	}
 }
 
@@ -1415,10 +1571,12 @@ void TCHFACCHL1Encoder::dispatch()
 void TCHFACCHL1Encoder::interleave(int blockOffset)
 {
 	// GSM 05.03, 3.1.3
-	for (int k=0; k<456; k++) {
-		int B = ( k + blockOffset ) % 8;
-		int j = 2*((49*k) % 57) + ((k%8)/4);
-		mI[B][j] = mC[k];
+	// Burst pointers in the order bits k, k+1, ... k+7 use them.
+	char *ip[8];
+	for (int b=0; b<8; b++) ip[b] = mI[(b+blockOffset)%8].begin();
+	const char *cp = mC.begin();
+	for (int k=0; k<456; k+=8) {
+		for (int b=0; b<8; b++) ip[b][interleaveIndex[k+b]] = cp[k+b];
 	}
 }
 
@@ -53,6 +53,7 @@ class L1FEC;
 class L1Encoder;
 class L1Decoder;
 class GeneratorL1Encoder;
+class XCCHL1Decoder;
 class SACCHL1Encoder;
 class SACCHL1Decoder;
 class SACCHL1FEC;
@@ -470,6 +471,52 @@ void *RACHL1DecoderServiceLoopAdapter(RACHL1Decoder*);
 
 
 
+/**
+	A pool of threads that decode the completed xCCH blocks of all channels,
+	so that a busy receive thread does not decode every channel in turn.
+	The receive thread hands over each block and goes on; the decoders post
+	their results to L2 from the pool threads.
+*/
+class L1DecoderPool {
+
+	private:
+
+	PointerFIFO mQ;				///< decoders with a block waiting
+	Mutex mLock;				///< protects mQ and mRunning
+	Signal mSignal;				///< signals a new entry in mQ
+	bool mRunning;				///< true once the threads are started
+
+	public:
+
+	L1DecoderPool()
+		:mRunning(false)
+	{ }
+
+	/**
+		Start the pool threads.
+		Without any, the receive thread keeps decoding its own blocks.
+	*/
+	void start(unsigned numThreads);
+
+	/**
+		Queue a decoder that has a block waiting.
+		@return false if the pool is not running, so the caller must decode the block itself.
+	*/
+	bool submit(XCCHL1Decoder* decoder);
+
+	private:
+
+	/** A loop that decodes blocks as they are submitted. */
+	void serviceLoop();
+
+	/** A "C" calling interface for pthreads. */
+	friend void *L1DecoderPoolServiceLoopAdapter(L1DecoderPool*);
+};
+
+void *L1DecoderPoolServiceLoopAdapter(L1DecoderPool*);
+
+
+
 /** Abstract L1 decoder for most control channels -- GSM 05.03 4.1 */
 class XCCHL1Decoder : public L1Decoder {
 
@@ -489,11 +536,32 @@ class XCCHL1Decoder : public L1Decoder {
 	GSM::Time mReadTime;		///< timestamp of the first burst
 	unsigned mRSSIHistory[4];
 
+	/**@name The block handed to the decoder pool. */
+	//@{
+	Mutex mBlockLock;			///< held while the block is replaced or decoded
+	SoftVector mBlockI[4];		///< i[][] of the block
+	GSM::Time mBlockTime;		///< timestamp of the first burst of the block
+	bool mBlockPending;			///< true from submission until decoding starts
+	//@}
+
 	public:
 
 	XCCHL1Decoder(unsigned wTN, const TDMAMapping& wMapping,
 		L1FEC *wParent);
 
+	/** Extend open() to discard a block left from the last transaction. */
+	void open();
+
+	/** Extend close() to discard a block still waiting for the pool. */
+	void close();
+
+	/**
+		Decode the waiting block, if any, and send it upstream.
+		A block of a channel that closed after submission is dropped.
+		Called by the decoder pool, or by writeLowSide if there is no pool.
+	*/
+	void decodeBlock();
+
 	protected:
 
 	/** Offset to the start of the L2 header. */
@@ -512,9 +580,12 @@ class XCCHL1Decoder : public L1Decoder {
 	  @return true if a new frame is ready for deinterleaving.
 	*/
 	virtual bool processBurst(const RxBurst&);
+
+	/** Move the completed i[] to the block and hand it to the decoder pool. */
+	void submitBlock();
 	
 	/**
-	  Deinterleave the i[] to c[].
+	  Deinterleave the block i[] to c[].
 	  This virtual method works for all block-interleaved channels (xCCHs).
 	  A different method is needed for diagonally-interleaved channels (TCHs).
 	*/
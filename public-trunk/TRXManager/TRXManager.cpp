@@ -123,7 +123,9 @@ void TransceiverManager::clockHandler()
 ::ARFCNManager::ARFCNManager(const char* wTRXAddress, int wBasePort, TransceiverManager &wTransceiver)
 	:mTransceiver(wTransceiver),
 	mDataSocket(wBasePort+100+1,wTRXAddress,wBasePort+1),
-	mControlSocket(wBasePort+100,wTRXAddress,wBasePort)
+	mDataShm(NULL),mUseShm(false),mDrainUDP(false),
+	mControlSocket(wBasePort+100,wTRXAddress,wBasePort),
+	mBatchSize(1),mTxBatchCount(0),mTxBatchFN(0)
 {
 	// The default demux table is full of NULL pointers.
 	for (int i=0; i<8; i++) {
@@ -169,12 +171,46 @@ void ::ARFCNManager::installDecoder(GSM::L1Decoder *wL1d)
 
 
 
+// Sizes of the burst records on the data interface, see README.TRXManager.
+static const unsigned txRecordLen = gSlotLen+1+4+1;
+static const unsigned rxRecordLen = gSlotLen+10;
+
+
+/** Length of a received burst record in a given format, 0 for an unknown format. */
+static unsigned rxFormatRecordLen(unsigned format)
+{
+	switch (format) {
+		case ARFCNManager::RX_BYTES: return rxRecordLen;
+		case ARFCNManager::RX_INT8: return 8+gSlotLen;
+		case ARFCNManager::RX_HARD: return 8+(gSlotLen+7)/8;
+		default: return 0;
+	}
+}
+
+
+/**
+	Tables mapping a received soft byte to a probability of "1".
+	One lookup per bit replaces the arithmetic, for either byte format.
+*/
+static struct SoftTables {
+	float bytes[256];
+	float int8[256];
+	SoftTables()
+	{
+		for (int i=0; i<256; i++) {
+			bytes[i] = i / 256.0F;
+			float p = 0.5F + ((signed char)i) / 254.0F;
+			int8[i] = p<0.0F ? 0.0F : p;
+		}
+	}
+} sSoftTables;
+
+
 void ::ARFCNManager::writeHighSide(const GSM::TxBurst& burst)
 {
 	LOG(DEEPDEBUG) << "transmit at time " << gBTS.clock().get() << ": " << burst;
 	// format the transmission request message
-	static const int bufferSize = gSlotLen+1+4+1;
-	char buffer[bufferSize];
+	char buffer[txRecordLen];
 	unsigned char *wp = (unsigned char*)buffer;
 	// slot
 	*wp++ = burst.time().TN();
@@ -194,21 +230,87 @@ void ::ARFCNManager::writeHighSide(const GSM::TxBurst& burst)
 	}
 	// write to the socket
 	mDataSocketLock.lock();
-	mDataSocket.write(buffer,bufferSize);
+	if (mBatchSize<=1) {
+		if (mUseShm) mDataShm->write(buffer,txRecordLen);
+		else mDataSocket.write(buffer,txRecordLen);
+		mDataSocketLock.unlock();
+		return;
+	}
+	// Bursts of a frame go out together.
+	// A burst of a new frame pushes out whatever is left of the last one,
+	// so no burst waits longer than a frame.
+	if (mTxBatchCount && FN!=mTxBatchFN) flushTxBatch();
+	memcpy(mTxBatch+1+mTxBatchCount*txRecordLen,buffer,txRecordLen);
+	mTxBatchFN = FN;
+	mTxBatchCount++;
+	if (mTxBatchCount>=mBatchSize) flushTxBatch();
 	mDataSocketLock.unlock();
 }
 
 
+void ::ARFCNManager::flushTxBatch()
+{
+	if (!mTxBatchCount) return;
+	mTxBatch[0] = mTxBatchCount;
+	if (mUseShm) mDataShm->write(mTxBatch,1+mTxBatchCount*txRecordLen);
+	else mDataSocket.write(mTxBatch,1+mTxBatchCount*txRecordLen);
+	mTxBatchCount = 0;
+}
+
+
 
 
 void ::ARFCNManager::driveRx()
 {
 	// read the message
 	char buffer[MAX_UDP_LENGTH];
-	int msgLen = mDataSocket.read(buffer);
-	if (msgLen<=0) SOCKET_ERROR;
-	// decode
-	unsigned char *rp = (unsigned char*)buffer;
+	int msgLen;
+	if (mUseShm) {
+		// Pairs with the barrier in useSharedMemory, so mDataShm is valid.
+		__sync_synchronize();
+		// Bursts the transceiver sent before it switched are still in the socket.
+		if (mDrainUDP) {
+			mDrainUDP = false;
+			while ((msgLen = mDataSocket.read(buffer,0))>0) decodeRxPacket(buffer,msgLen);
+		}
+		// Time out now and then, in case the transceiver refused the channel.
+		msgLen = mDataShm->read(buffer,100);
+		if (msgLen<0) return;
+		LOG(DEEPDEBUG) << "packet spent " << mDataShm->lastDelay() << " us in shared memory";
+	} else {
+		msgLen = mDataSocket.read(buffer);
+		if (msgLen<=0) SOCKET_ERROR;
+	}
+	decodeRxPacket(buffer,msgLen);
+}
+
+
+void ::ARFCNManager::decodeRxPacket(const char* buffer, int msgLen)
+{
+	const unsigned char *rp = (const unsigned char*)buffer;
+	// one burst, the original protocol
+	if ((unsigned)msgLen==rxRecordLen) {
+		decodeRxBurst(rp,RX_BYTES);
+		return;
+	}
+	// a header with the format and count, followed by that many bursts
+	RxFormat format = (RxFormat)(rp[0]>>4);
+	unsigned count = rp[0] & 0x0f;
+	unsigned recordLen = rxFormatRecordLen(format);
+	if (!recordLen || (unsigned)msgLen!=1+count*recordLen) {
+		LOG(ERROR) << "badly formatted packet on TRX->GSM interface, length " << msgLen;
+		return;
+	}
+	rp++;
+	for (unsigned i=0; i<count; i++) {
+		decodeRxBurst(rp,format);
+		rp += recordLen;
+	}
+}
+
+
+void ::ARFCNManager::decodeRxBurst(const unsigned char* rp, RxFormat format)
+{
 	// timeslot number
 	unsigned TN = *rp++;
 	// frame number
@@ -217,17 +319,22 @@ void ::ARFCNManager::driveRx()
 	FN = (FN<<8) + (*rp++);
 	FN = (FN<<8) + (*rp++);
 	// physcial header data
-	signed char* srp = (signed char*)rp++;
+	const signed char* srp = (const signed char*)rp++;
 	// reported RSSI is negated dB wrt full scale
 	int RSSI = *srp;
-	srp = (signed char*)rp++;
+	srp = (const signed char*)rp++;
 	// timing error comes in 1/256 symbol steps
 	// because that fits nicely in 2 bytes
 	int timingError = *srp;
 	timingError = (timingError<<8) | (*rp++);
-	// soft symbols
+	// soft symbols, straight into the burst's storage
 	float data[gSlotLen];
-	for (unsigned i=0; i<gSlotLen; i++) data[i] = (*rp++) / 256.0F;
+	if (format==RX_HARD) {
+		for (unsigned i=0; i<gSlotLen; i++) data[i] = (rp[i/8] >> (7-i%8)) & 0x01;
+	} else {
+		const float *table = format==RX_INT8 ? sSoftTables.int8 : sSoftTables.bytes;
+		for (unsigned i=0; i<gSlotLen; i++) data[i] = table[*rp++];
+	}
 	// demux
 	receiveBurst(RxBurst(data,GSM::Time(FN,TN),timingError/256.0F,-RSSI));
 }
@@ -455,6 +562,91 @@ bool ::ARFCNManager::setMaxDelay(unsigned km)
         return true;
 }
 
+bool ::ARFCNManager::setRxFormat(unsigned TN, RxFormat format)
+{
+	assert(TN<8);
+	char paramBuf[MAX_UDP_LENGTH];
+	sprintf(paramBuf,"%d %d", TN, format);
+	int status;
+	// Older transceivers may not answer an unknown command properly.
+	try {
+		status = sendCommand("SETRXFMT",paramBuf);
+	} catch (SocketError) {
+		status = -1;
+	}
+	if (status!=0) {
+		LOG(NOTICE) << "SETRXFMT failed with status " << status << ", TN " << TN << " keeps the byte format";
+		return false;
+	}
+	return true;
+}
+
+
+bool ::ARFCNManager::useSharedMemory()
+{
+	if (mUseShm) return true;
+	char name[100];
+	sprintf(name,"/OpenBTS.TRX.%u",mDataSocket.port());
+	if (!mDataShm) {
+		ShmSocket *shm = new ShmSocket(name,true);
+		if (!shm->valid()) {
+			delete shm;
+			LOG(ALARM) << "cannot create shared memory data channel " << name;
+			return false;
+		}
+		mDataShm = shm;
+	}
+	// Switch the reader first, it goes back to UDP if the transceiver refuses.
+	// The barrier publishes mDataShm before the threads that test mUseShm see it.
+	__sync_synchronize();
+	mUseShm = true;
+	__sync_synchronize();
+	int status;
+	// Older transceivers may not answer an unknown command properly.
+	try {
+		status = sendCommand("SHMDATA",name);
+	} catch (SocketError) {
+		status = -1;
+	}
+	mDataSocketLock.lock();
+	if (status!=0) {
+		LOG(NOTICE) << "transceiver refused shared memory data channel, using UDP";
+		mUseShm = false;
+	} else {
+		// an empty batch wakes the transceiver reader still waiting on the socket
+		char empty = 0;
+		mDataSocket.write(&empty,1);
+		mDrainUDP = true;
+	}
+	mDataSocketLock.unlock();
+	return mUseShm;
+}
+
+
+bool ::ARFCNManager::setBurstBatch(unsigned count)
+{
+	// no more than one frame
+	if (count<1) count=1;
+	if (count>8) count=8;
+	int accepted = 1;
+	int status;
+	// Older transceivers may not answer an unknown command properly.
+	try {
+		status = sendCommand("SETBATCH",count,&accepted);
+	} catch (SocketError) {
+		status = -1;
+	}
+	if (status!=0 || accepted<1 || accepted>(int)count) {
+		LOG(NOTICE) << "transceiver does not batch bursts, using one burst per packet";
+		accepted = 1;
+	}
+	mDataSocketLock.lock();
+	flushTxBatch();
+	mBatchSize = accepted;
+	mDataSocketLock.unlock();
+	return accepted>1;
+}
+
 signed ::ARFCNManager::setRxGain(signed rxGain)
 {
         signed newRxGain;
@@ -477,6 +669,39 @@ signed ::ARFCNManager::getNoiseLevel(void)
         return noiselevel;
 }
 
+bool ::ARFCNManager::getTxStats(unsigned TN, TxStats& stats)
+{
+	char cmdBuf[MAX_UDP_LENGTH];
+	char response[MAX_UDP_LENGTH];
+	sprintf(cmdBuf,"CMD TXSTATS %u",TN);
+	// Older transceivers may not answer an unknown command properly.
+	try {
+		if (sendCommandPacket(cmdBuf,response)<=0) return false;
+	} catch (SocketError) {
+		return false;
+	}
+	int status = -1;
+	unsigned rspTN;
+	int count = sscanf(response,"RSP TXSTATS %d %u %u %u %u %u", &status, &rspTN,
+		&stats.sent, &stats.late, &stats.dropped, &stats.filled);
+	return (count==6) && (status==0) && (rspTN==TN);
+}
+
+bool ::ARFCNManager::getTxLatency(int& latency, int& floor, int& ceiling, unsigned& underruns)
+{
+	char response[MAX_UDP_LENGTH];
+	// Older transceivers may not answer an unknown command properly.
+	try {
+		if (sendCommandPacket("CMD TXLATENCY",response)<=0) return false;
+	} catch (SocketError) {
+		return false;
+	}
+	int status = -1;
+	int count = sscanf(response,"RSP TXLATENCY %d %d %d %d %u", &status,
+		&latency, &floor, &ceiling, &underruns);
+	return (count==5) && (status==0);
+}
+
 void ::ARFCNManager::receiveBurst(const RxBurst& inBurst)
 {
 	LOG(DEEPDEBUG) << "receiveBurst: " << inBurst;
@@ -33,6 +33,7 @@
 
 #include "Threads.h"
 #include "Sockets.h"
+#include "ShmSocket.h"
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "GSMTransfer.h"
@@ -83,6 +84,7 @@ class TransceiverManager {
 	/**@name Accessors. */
 	//@{
 	ARFCNManager* ARFCN(unsigned i) { assert(i<mARFCNs.size()); return mARFCNs.at(i); }
+	unsigned numARFCNs() const { return mARFCNs.size(); }
 	//@}
 
 	/** Start the clock management thread and all ARFCN managers. */
@@ -117,6 +119,9 @@ class ARFCNManager {
 
 	Mutex mDataSocketLock;			///< lock to prevent contentional for the socket
 	UDPSocket mDataSocket;			///< socket for data transfer
+	ShmSocket* mDataShm;			///< shared memory data channel, if the transceiver accepted one
+	volatile bool mUseShm;			///< true while data goes through mDataShm instead of mDataSocket
+	volatile bool mDrainUDP;		///< true until driveRx reads the bursts left in mDataSocket by the switch
 	Mutex mControlLock;				///< lock to prevent overlapping transactions
 	UDPSocket mControlSocket;		///< socket for radio control
 
@@ -131,9 +136,24 @@ class ARFCNManager {
 
 	unsigned mARFCN;						///< the current ARFCN
 
+	/**@name Transmit burst batching, protected by mDataSocketLock. */
+	//@{
+	unsigned mBatchSize;					///< bursts per data packet, 1 for the one-burst protocol
+	unsigned mTxBatchCount;					///< bursts waiting in mTxBatch
+	uint32_t mTxBatchFN;					///< frame number of the waiting bursts
+	char mTxBatch[MAX_UDP_LENGTH];			///< batched transmit packet being assembled
+	//@}
+
 
 	public:
 
+	/** Soft bit formats of received bursts on the data interface, see README.TRXManager. */
+	enum RxFormat {
+		RX_BYTES=0,		///< one byte per bit, 0..255
+		RX_INT8=1,		///< one signed byte per bit, -127..127
+		RX_HARD=2		///< hard decisions, 8 bits per byte
+	};
+
 	ARFCNManager(const char* wTRXAddress, int wBasePort, TransceiverManager &wTRX);
 
 	/** Start the uplink thread. */
@@ -187,6 +207,32 @@ class ARFCNManager {
         */
         signed getNoiseLevel(void);
 
+	/** Transmit burst accounting of a timeslot, as kept by the transceiver. */
+	struct TxStats {
+		unsigned sent;		///< bursts sent on time
+		unsigned late;		///< bursts that arrived with less than the transmit latency to spare
+		unsigned dropped;	///< bursts discarded because their time had passed
+		unsigned filled;	///< timeslots filled in by the transceiver for lack of a burst
+	};
+
+	/**
+		Get the transmit burst accounting of a timeslot.
+		@param TN The timeslot.
+		@param stats The counts since the transceiver started.
+		@return true on success, false if the transceiver does not keep them.
+	*/
+	bool getTxStats(unsigned TN, TxStats& stats);
+
+	/**
+		Get the transmit latency of the transceiver and the bounds it measured for it, in timeslots.
+		@param latency The current latency.
+		@param floor The latency needed to cover the transceiver's own scheduling delays.
+		@param ceiling The latency that most bursts from the core arrive in time for, -1 if unknown.
+		@param underruns The radio underruns so far.
+		@return true on success, false if the transceiver does not report them.
+	*/
+	bool getTxLatency(int& latency, int& floor, int& ceiling, unsigned& underruns);
+
 	/**
 		Set power wrt full scale.
 		@param dB Power level wrt full power.
@@ -209,6 +255,31 @@ class ARFCNManager {
 	*/
 	bool setSlot(unsigned TN, unsigned combo);
 
+	/**
+		Set the soft bit format the transceiver uses for received bursts on a slot.
+		@param TN The timeslot number 0..7.
+		@param format The format, RX_HARD only where hard decisions are good enough.
+		@return true on success, the slot keeps the RX_BYTES format on failure.
+	*/
+	bool setRxFormat(unsigned TN, RxFormat format);
+
+	/**
+		Move the data interface from UDP to a shared memory channel.
+		Only works with the transceiver on the same host; otherwise UDP stays in use.
+		Best called before powerOn, downlink bursts in flight during the switch are lost.
+		Uplink bursts the transceiver sent over UDP before it switched are still read.
+		@return true if the transceiver accepted the channel.
+	*/
+	bool useSharedMemory();
+
+	/**
+		Negotiate the number of bursts carried in each data packet.
+		A transceiver that does not know the command keeps the one-burst protocol.
+		@param count Desired bursts per packet, limited to 1..8.
+		@return true if the transceiver accepted batching.
+	*/
+	bool setBurstBatch(unsigned count);
+
 	//@}
 
 
@@ -222,6 +293,15 @@ class ARFCNManager {
 	/** Action for reception. */
 	void driveRx();
 
+	/** Decode a received data packet of one or more bursts. */
+	void decodeRxPacket(const char* buffer, int msgLen);
+
+	/** Decode one received burst record and hand it to receiveBurst. */
+	void decodeRxBurst(const unsigned char* rp, RxFormat format);
+
+	/** Send the waiting transmit bursts, caller holds mDataSocketLock. */
+	void flushTxBatch();
+
 	/** Demultiplex and process a received burst. */
 	void receiveBurst(const GSM::RxBurst&);
 
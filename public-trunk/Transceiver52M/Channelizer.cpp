@@ -0,0 +1,212 @@
+/*
+ * Polyphase channelizer and synthesizer for multiple carriers
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "Channelizer.h"
+#include "convolve.h"
+#include "FFT.h"
+
+/*
+ * Windowed sinc lowpass with unity gain at DC
+ *
+ * The cutoff sits at the channel edge, half the channel rate. With the
+ * 4-term Blackman-Harris window the transition band is about 8 / len of
+ * the wideband rate wide, centered on the cutoff, and the stopband is
+ * better than 90 dB down.
+ */
+static void design_prototype(float *h, int len, int chans)
+{
+	int i;
+	double x, w, sum = 0.0;
+	double mid = (len - 1) / 2.0;
+
+	for (i = 0; i < len; i++) {
+		x = (i - mid) / chans;
+		h[i] = (x == 0.0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+
+		w = 2.0 * M_PI * i / (len - 1);
+		h[i] *= 0.35875 - 0.48829 * cos(w) +
+			0.14128 * cos(2.0 * w) - 0.01168 * cos(3.0 * w);
+		sum += h[i];
+	}
+
+	for (i = 0; i < len; i++)
+		h[i] /= sum;
+}
+
+ChannelizerBase::ChannelizerBase(int chans, int taps, int chunk)
+	: mChans(chans), mTaps(taps), mChunk(chunk)
+{
+	int i, n, len = chans * taps;
+	float *h = new float[len];
+
+	assert(!(chans & (chans - 1)));
+
+	design_prototype(h, len, chans);
+
+	/*
+	 * Path n holds taps n, n + M, n + 2M, ... stored in reverse order
+	 * so that the dot product walks the path history forward.
+	 */
+	mPartitions = new float[2 * len];
+	for (n = 0; n < chans; n++) {
+		for (i = 0; i < taps; i++) {
+			partition(n)[2 * i + 0] = h[n + (taps - 1 - i) * chans];
+			partition(n)[2 * i + 1] = 0.0f;
+		}
+	}
+	delete[] h;
+
+	mHistory = new float[2 * chans * (taps - 1 + chunk)];
+	mBlock = new float[2 * chans];
+	mFFT = new FFT(chans);
+
+	reset();
+}
+
+ChannelizerBase::~ChannelizerBase()
+{
+	delete mFFT;
+	delete[] mPartitions;
+	delete[] mHistory;
+	delete[] mBlock;
+}
+
+void ChannelizerBase::reset()
+{
+	memset(mHistory, 0,
+	       2 * mChans * (mTaps - 1 + mChunk) * sizeof(float));
+}
+
+void ChannelizerBase::update(int len)
+{
+	for (int n = 0; n < mChans; n++) {
+		memmove(history(n), &history(n)[2 * len],
+			2 * (mTaps - 1) * sizeof(float));
+	}
+}
+
+Channelizer::Channelizer(int chans, int taps, int chunk)
+	: ChannelizerBase(chans, taps, chunk)
+{
+}
+
+/*
+ * Each block of M wideband samples feeds one sample into every path,
+ * newest sample into path 0. The path outputs are combined by an
+ * inverse FFT, which mixes every channel down to baseband at once.
+ */
+int Channelizer::rotate(const short *in, int len, float **out)
+{
+	int i, n, k, blocks, num = 0;
+	float *hist;
+
+	while (num < len) {
+		blocks = (len - num < mChunk) ? len - num : mChunk;
+
+		for (n = 0; n < mChans; n++) {
+			hist = &history(n)[2 * (mTaps - 1)];
+			for (i = 0; i < blocks; i++) {
+				hist[2 * i + 0] = in[2 * (i * mChans + mChans - 1 - n) + 0];
+				hist[2 * i + 1] = in[2 * (i * mChans + mChans - 1 - n) + 1];
+			}
+		}
+
+		for (i = 0; i < blocks; i++) {
+			for (n = 0; n < mChans; n++) {
+				convolve_impl->dot_real(&history(n)[2 * i],
+							partition(n), mTaps,
+							&mBlock[2 * n]);
+			}
+
+			mFFT->inverse(mBlock);
+
+			for (k = 0; k < mChans; k++) {
+				if (!out[k])
+					continue;
+				out[k][2 * (num + i) + 0] = mBlock[2 * k + 0];
+				out[k][2 * (num + i) + 1] = mBlock[2 * k + 1];
+			}
+		}
+
+		update(blocks);
+
+		in += 2 * blocks * mChans;
+		num += blocks;
+	}
+
+	return num;
+}
+
+/* Interpolation by M loses a factor of M in gain, restore it here */
+Synthesizer::Synthesizer(int chans, int taps, int chunk)
+	: ChannelizerBase(chans, taps, chunk)
+{
+	for (int i = 0; i < 2 * chans * taps; i++)
+		mPartitions[i] *= chans;
+}
+
+/*
+ * The inverse FFT of each block of channel samples mixes every channel
+ * up to its center, then path n filters its share of the transform and
+ * produces wideband sample n of the block.
+ */
+int Synthesizer::rotate(float **in, int len, short *out)
+{
+	int i, n, k, blocks, num = 0;
+	float sum[2];
+
+	while (num < len) {
+		blocks = (len - num < mChunk) ? len - num : mChunk;
+
+		for (i = 0; i < blocks; i++) {
+			for (k = 0; k < mChans; k++) {
+				mBlock[2 * k + 0] = in[k] ? in[k][2 * (num + i) + 0] : 0.0f;
+				mBlock[2 * k + 1] = in[k] ? in[k][2 * (num + i) + 1] : 0.0f;
+			}
+
+			mFFT->inverse(mBlock);
+
+			for (n = 0; n < mChans; n++) {
+				history(n)[2 * (mTaps - 1 + i) + 0] = mBlock[2 * n + 0];
+				history(n)[2 * (mTaps - 1 + i) + 1] = mBlock[2 * n + 1];
+			}
+		}
+
+		for (i = 0; i < blocks; i++) {
+			for (n = 0; n < mChans; n++) {
+				convolve_impl->dot_real(&history(n)[2 * i],
+							partition(n), mTaps, sum);
+				out[2 * (i * mChans + n) + 0] = (short) sum[0];
+				out[2 * (i * mChans + n) + 1] = (short) sum[1];
+			}
+		}
+
+		update(blocks);
+
+		out += 2 * blocks * mChans;
+		num += blocks;
+	}
+
+	return num * mChans;
+}
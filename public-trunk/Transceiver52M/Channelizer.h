@@ -0,0 +1,108 @@
+/*
+ * Polyphase channelizer and synthesizer for multiple carriers
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+class FFT;
+
+/*
+ * Critically sampled M-path polyphase filterbank
+ *
+ * The wideband stream runs at M times the channel rate and channel k
+ * is centered at k / M of the wideband rate, so channels above M / 2
+ * sit at negative frequencies. One windowed sinc prototype, designed
+ * once at the wideband rate, is split into M reversed partitions. Each
+ * block of M wideband samples then costs M short dot products and one
+ * M point FFT, shared by all channels.
+ *
+ * Filter state is carried across calls so that chunk boundaries are
+ * seamless. Adjacent paths overlap only in the transition bands,
+ * where a GSM carrier is already some 30 dB down, and the stopband
+ * beyond them is better than 90 dB.
+ */
+class ChannelizerBase {
+public:
+	/*
+	 * chans    - number of paths, a power of two
+	 * taps     - prototype taps per path
+	 * chunk    - largest number of channel samples handled at once
+	 */
+	ChannelizerBase(int chans, int taps, int chunk);
+	virtual ~ChannelizerBase();
+
+	int chans() const { return mChans; }
+
+	/* Delay of a synthesizer followed by a channelizer, in wideband samples */
+	int roundTripDelay() const { return mChans * (mTaps - 1); }
+
+	/* Clear the filter state */
+	void reset();
+
+protected:
+	int mChans;
+	int mTaps;
+	int mChunk;
+
+	FFT *mFFT;
+	float *mPartitions;		/* M reversed partitions, as complex */
+	float *mHistory;		/* per path history followed by new input */
+	float *mBlock;			/* FFT input and output */
+
+	float *partition(int path) const
+	{
+		return &mPartitions[2 * path * mTaps];
+	}
+	float *history(int path) const
+	{
+		return &mHistory[2 * path * (mTaps - 1 + mChunk)];
+	}
+
+	/* Keep the tail of every path as history for the next call */
+	void update(int len);
+};
+
+/* Split a wideband stream into channels */
+class Channelizer : public ChannelizerBase {
+public:
+	Channelizer(int chans, int taps, int chunk);
+
+	/*
+	 * Convert len * chans int16 wideband samples into len float
+	 * samples on each channel. Channels with a NULL output are
+	 * filtered but not stored. Returns samples written per channel.
+	 */
+	int rotate(const short *in, int len, float **out);
+};
+
+/* Combine channels into a wideband stream */
+class Synthesizer : public ChannelizerBase {
+public:
+	Synthesizer(int chans, int taps, int chunk);
+
+	/*
+	 * Combine len float samples of each channel into len * chans
+	 * int16 wideband samples. A NULL input is a silent channel.
+	 * Returns wideband samples written.
+	 */
+	int rotate(float **in, int len, short *out);
+};
+
+#endif /* CHANNELIZER_H */
@@ -0,0 +1,108 @@
+/*
+ * Radix-2 complex FFT
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include <assert.h>
+
+#include "FFT.h"
+
+FFT::FFT(int size)
+	: mSize(size)
+{
+	int i, j, bits = 0;
+
+	assert(size >= 2 && !(size & (size - 1)));
+
+	while ((1 << bits) < size)
+		bits++;
+
+	mReverse = new int[size];
+	for (i = 0; i < size; i++) {
+		mReverse[i] = 0;
+		for (j = 0; j < bits; j++) {
+			if (i & (1 << j))
+				mReverse[i] |= 1 << (bits - 1 - j);
+		}
+	}
+
+	mTwiddle = new float[size];
+	for (i = 0; i < size / 2; i++) {
+		mTwiddle[2 * i + 0] = cos(2.0 * M_PI * i / size);
+		mTwiddle[2 * i + 1] = -sin(2.0 * M_PI * i / size);
+	}
+}
+
+FFT::~FFT()
+{
+	delete[] mReverse;
+	delete[] mTwiddle;
+}
+
+void FFT::forward(float *data) const
+{
+	transform(data, false);
+}
+
+void FFT::inverse(float *data) const
+{
+	transform(data, true);
+}
+
+/* Iterative decimation in time, conjugate twiddles for the inverse */
+void FFT::transform(float *x, bool inv) const
+{
+	int i, j, k, len, half, step;
+	float wr, wi, tr, ti, sign = inv ? -1.0f : 1.0f;
+	float *a, *b;
+
+	for (i = 0; i < mSize; i++) {
+		j = mReverse[i];
+		if (j > i) {
+			tr = x[2 * i + 0];
+			ti = x[2 * i + 1];
+			x[2 * i + 0] = x[2 * j + 0];
+			x[2 * i + 1] = x[2 * j + 1];
+			x[2 * j + 0] = tr;
+			x[2 * j + 1] = ti;
+		}
+	}
+
+	for (len = 2; len <= mSize; len <<= 1) {
+		half = len / 2;
+		step = mSize / len;
+
+		for (k = 0; k < half; k++) {
+			wr = mTwiddle[2 * k * step + 0];
+			wi = mTwiddle[2 * k * step + 1] * sign;
+
+			for (i = k; i < mSize; i += len) {
+				a = &x[2 * i];
+				b = &x[2 * (i + half)];
+
+				tr = b[0] * wr - b[1] * wi;
+				ti = b[0] * wi + b[1] * wr;
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
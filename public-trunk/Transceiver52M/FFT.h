@@ -0,0 +1,50 @@
+/*
+ * Radix-2 complex FFT
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+/*
+ * In-place transforms of interleaved complex float data
+ *
+ * Twiddle factors and the bit reversal permutation are computed once
+ * per size, after which the transforms do not allocate and may be run
+ * from several threads at once. The inverse transform is unscaled.
+ */
+class FFT {
+public:
+	/* size - transform length, a power of two */
+	FFT(int size);
+	~FFT();
+
+	int size() const { return mSize; }
+
+	void forward(float *data) const;
+	void inverse(float *data) const;
+
+private:
+	int mSize;
+	int *mReverse;			/* bit reversed index table */
+	float *mTwiddle;		/* e^(-2 pi j k / size), k < size / 2 */
+
+	void transform(float *data, bool inv) const;
+};
+
+#endif /* FFT_H */
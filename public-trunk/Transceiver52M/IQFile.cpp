@@ -0,0 +1,323 @@
+/*
+ * IQ capture and replay files
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <Logger.h>
+#include "IQFile.h"
+
+IQCapture::IQCapture()
+	: fd(-1), rate(0.0), seconds(0.0), record_size(0), map_len(0),
+	  hdr(NULL)
+{
+}
+
+IQCapture::~IQCapture()
+{
+	close();
+}
+
+bool IQCapture::open(const char *path, double rate, double seconds)
+{
+	close();
+
+	fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		LOG(ALARM) << "cannot create capture " << path << ": "
+			   << strerror(errno);
+		return false;
+	}
+
+	this->rate = rate;
+	this->seconds = seconds;
+
+	LOG(NOTICE) << "capturing " << seconds << " seconds of receive "
+		    << "samples to " << path;
+	return true;
+}
+
+void IQCapture::close()
+{
+	if (hdr)
+		munmap(hdr, map_len);
+	if (fd >= 0)
+		::close(fd);
+
+	hdr = NULL;
+	fd = -1;
+}
+
+/* Size and map the file once the read length is known */
+bool IQCapture::map(int record_len)
+{
+	uint64_t capacity;
+	void *addr;
+
+	record_size = sizeof(struct iq_record) +
+		      2 * record_len * sizeof(int16_t);
+	capacity = (uint64_t) (seconds * rate / record_len) + 1;
+	map_len = sizeof(struct iq_header) + capacity * record_size;
+
+	if (ftruncate(fd, map_len) < 0) {
+		LOG(ALARM) << "cannot size capture: " << strerror(errno);
+		close();
+		return false;
+	}
+
+	addr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		LOG(ALARM) << "cannot map capture: " << strerror(errno);
+		close();
+		return false;
+	}
+
+	hdr = (struct iq_header *) addr;
+	memcpy(hdr->magic, IQ_MAGIC, sizeof(hdr->magic));
+	hdr->version = IQ_VERSION;
+	hdr->header_len = sizeof(struct iq_header);
+	hdr->rate = rate;
+	hdr->record_len = record_len;
+	hdr->start_fn = 0;
+	hdr->capacity = capacity;
+	hdr->count = 0;
+	hdr->start = 0;
+
+	return true;
+}
+
+struct iq_record *IQCapture::slot(uint64_t n)
+{
+	char *base = (char *) hdr + hdr->header_len;
+
+	return (struct iq_record *) (base + (n % hdr->capacity) * record_size);
+}
+
+void IQCapture::write(const short *buf, int len, TIMESTAMP timestamp,
+		      bool overrun, const GSM::Time &clock)
+{
+	struct iq_record *rec;
+
+	if (fd < 0)
+		return;
+	if (!hdr && !map(len))
+		return;
+
+	if (len > (int) hdr->record_len)
+		len = hdr->record_len;
+
+	if (!hdr->count) {
+		hdr->start = timestamp;
+		hdr->start_fn = clock.FN();
+	}
+
+	rec = slot(hdr->count);
+	rec->timestamp = timestamp;
+	rec->len = len;
+	rec->flags = overrun ? IQ_OVERRUN : 0;
+	memcpy(rec + 1, buf, 2 * len * sizeof(int16_t));
+
+	/* Count the record only once it is complete */
+	hdr->count++;
+}
+
+IQReplay::IQReplay()
+	: map(NULL), map_len(0), replay_rate(0.0), span(0), start_fn(-1),
+	  cursor(0)
+{
+}
+
+IQReplay::~IQReplay()
+{
+	if (map)
+		munmap(map, map_len);
+}
+
+bool IQReplay::open(const char *path)
+{
+	const struct iq_header *hdr;
+	const struct iq_record *rec;
+	struct stat st;
+	segment seg;
+	uint64_t first, num, overruns = 0;
+	size_t record_size;
+	int fd;
+
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		LOG(ALARM) << "cannot open " << path << ": " << strerror(errno);
+		return false;
+	}
+
+	if ((fstat(fd, &st) < 0) || (st.st_size < (off_t) (2 * sizeof(short)))) {
+		LOG(ALARM) << "no samples in " << path;
+		::close(fd);
+		return false;
+	}
+
+	map_len = st.st_size;
+	map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		LOG(ALARM) << "cannot map " << path << ": " << strerror(errno);
+		map = NULL;
+		return false;
+	}
+
+	hdr = (const struct iq_header *) map;
+	if ((map_len < sizeof(*hdr)) ||
+	    memcmp(hdr->magic, IQ_MAGIC, sizeof(hdr->magic))) {
+		seg.start = 0;
+		seg.len = map_len / (2 * sizeof(short));
+		seg.overrun = false;
+		seg.data = (const int16_t *) map;
+		segments.push_back(seg);
+		span = seg.len;
+
+		LOG(NOTICE) << "playing " << span << " raw samples from "
+			    << path;
+		return true;
+	}
+
+	record_size = sizeof(struct iq_record) +
+		      2 * hdr->record_len * sizeof(int16_t);
+	if ((hdr->version < 1) || (hdr->version > IQ_VERSION) ||
+	    !hdr->capacity ||
+	    (hdr->header_len + hdr->capacity * record_size > map_len)) {
+		LOG(ALARM) << "bad capture " << path;
+		return false;
+	}
+
+	num = hdr->count < hdr->capacity ? hdr->count : hdr->capacity;
+	first = hdr->count - num;
+	if (!num) {
+		LOG(ALARM) << "no samples in " << path;
+		return false;
+	}
+
+	for (uint64_t n = first; n < first + num; n++) {
+		rec = (const struct iq_record *) ((const char *) map +
+		      hdr->header_len + (n % hdr->capacity) * record_size);
+
+		seg.start = rec->timestamp;
+		seg.len = rec->len;
+		seg.overrun = rec->flags & IQ_OVERRUN;
+		seg.data = (const int16_t *) (rec + 1);
+
+		if (!segments.empty() &&
+		    (seg.start < segments.back().start + segments.back().len)) {
+			LOG(ALARM) << "timestamps out of order in " << path;
+			return false;
+		}
+
+		segments.push_back(seg);
+		overruns += seg.overrun;
+	}
+
+	/* Stream offsets count from the last superframe before the oldest */
+	long long super = (long long) (hdr->rate * IQ_SUPERFRAME + 0.5);
+	long long base = (segments[0].start - hdr->start) / super;
+	if (hdr->version >= 2)
+		start_fn = (hdr->start_fn + base * IQ_SUPERFRAME_FRAMES) %
+			   GSM::gHyperframe;
+	base = hdr->start + base * super;
+	for (size_t i = 0; i < segments.size(); i++)
+		segments[i].start -= base;
+	span = segments.back().start + segments.back().len;
+
+	replay_rate = hdr->rate;
+
+	LOG(NOTICE) << "playing " << num << " reads, " << span
+		    << " samples at " << replay_rate << " sps from " << path
+		    << ", " << overruns << " overruns";
+	return true;
+}
+
+/* Segment that holds pos or the next one after it, NULL past the end */
+const IQReplay::segment *IQReplay::find(long long pos)
+{
+	size_t lo = 0, hi = segments.size();
+
+	/* Reads are usually sequential */
+	if (cursor < segments.size() && (segments[cursor].start <= pos)) {
+		if (pos < segments[cursor].start + segments[cursor].len)
+			return &segments[cursor];
+		if ((cursor + 1 < segments.size()) &&
+		    (pos < segments[cursor + 1].start +
+			   segments[cursor + 1].len)) {
+			cursor++;
+			return &segments[cursor];
+		}
+	}
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (segments[mid].start + segments[mid].len <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == segments.size())
+		return NULL;
+
+	cursor = lo;
+	return &segments[lo];
+}
+
+bool IQReplay::read(short *buf, int len, long long offset)
+{
+	const segment *seg;
+	long long pos = offset % span;
+	bool overrun = false;
+	int n;
+
+	while (len > 0) {
+		seg = find(pos);
+
+		if (!seg || (seg->start > pos)) {
+			/* A gap, up to the next segment or the end */
+			n = (seg ? seg->start : span) - pos;
+			if (n > len)
+				n = len;
+			memset(buf, 0, 2 * n * sizeof(short));
+		} else {
+			n = seg->start + seg->len - pos;
+			if (n > len)
+				n = len;
+			memcpy(buf, seg->data + 2 * (pos - seg->start),
+			       2 * n * sizeof(short));
+			overrun |= seg->overrun;
+		}
+
+		buf += 2 * n;
+		len -= n;
+		pos += n;
+		if (pos == span)
+			pos = 0;
+	}
+
+	return overrun;
+}
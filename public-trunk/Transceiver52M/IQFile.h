@@ -0,0 +1,150 @@
+/*
+ * IQ capture and replay files
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef IQFILE_H
+#define IQFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "radioDevice.h"
+#include <GSMCommon.h>
+
+#define IQ_MAGIC		"OBTSIQ\0"
+#define IQ_VERSION		2
+
+/* Record flags */
+#define IQ_OVERRUN		0x1
+
+/* Duration of 26 x 51 TDMA frames, over which all channel mappings repeat */
+#define IQ_SUPERFRAME		6.12
+#define IQ_SUPERFRAME_FRAMES	(26 * 51)
+
+/*
+ * A capture is a header followed by a ring of fixed size records, one
+ * per device read, in host byte order. The ring holds the last capacity
+ * reads and count says how many were written in all, so the oldest
+ * record sits at slot count % capacity once the ring has wrapped. Each
+ * record carries the timestamp of its first sample and is followed by
+ * len interleaved int16 IQ samples, padded to record_len. The start
+ * field keeps the timestamp of the first read and start_fn the frame
+ * number the GSM clock of the capturing transceiver had at that read,
+ * where timeslot 0 of that frame began. Version 1 captures have no
+ * start_fn.
+ */
+struct iq_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_len;
+	double rate;
+	uint32_t record_len;
+	uint32_t start_fn;
+	uint64_t capacity;
+	uint64_t count;
+	uint64_t start;
+};
+
+struct iq_record {
+	uint64_t timestamp;
+	uint32_t len;
+	uint32_t flags;
+};
+
+/*
+ * Records device reads to a memory mapped file. The file is sized on the
+ * first write, from the length of that read, to hold the requested time.
+ * Writes only copy into the mapping, the kernel writes it back.
+ */
+class IQCapture {
+public:
+	IQCapture();
+	~IQCapture();
+
+	/* Create the file for about seconds of samples at rate */
+	bool open(const char *path, double rate, double seconds);
+	void close();
+
+	/* Record a read, clock is the GSM time of its first sample */
+	void write(const short *buf, int len, TIMESTAMP timestamp,
+		   bool overrun, const GSM::Time &clock);
+
+private:
+	int fd;
+	double rate;
+	double seconds;
+	size_t record_size;
+	size_t map_len;
+	struct iq_header *hdr;
+
+	bool map(int record_len);
+	struct iq_record *slot(uint64_t n);
+};
+
+/*
+ * Plays a capture, or a file of raw interleaved int16 IQ, as one sample
+ * stream that loops at the end. Samples between records that are not
+ * contiguous read as zeros. The stream starts a whole number of
+ * superframes after the first read of the capture, at or before its
+ * oldest record. A transceiver whose clock starts at startFN() when it
+ * reads the start of the stream sees every burst at its original frame
+ * number and timeslot, until the stream loops.
+ */
+class IQReplay {
+public:
+	IQReplay();
+	~IQReplay();
+
+	bool open(const char *path);
+
+	/* Capture sample rate, or 0 for raw files */
+	double rate() const { return replay_rate; }
+
+	/* Samples from the start of the stream to its end */
+	long long length() const { return span; }
+
+	/* Frame number at the start of the stream, -1 if not recorded */
+	int startFN() const { return start_fn; }
+
+	/*
+	 * Copy len samples from offset into the stream, returns true if
+	 * any of them come from a read that overran
+	 */
+	bool read(short *buf, int len, long long offset);
+
+private:
+	struct segment {
+		long long start;
+		int len;
+		bool overrun;
+		const int16_t *data;
+	};
+
+	void *map;
+	size_t map_len;
+	double replay_rate;
+	long long span;
+	int start_fn;
+	std::vector<segment> segments;
+	size_t cursor;
+
+	const segment *find(long long pos);
+};
+
+#endif /* IQFILE_H */
@@ -0,0 +1,146 @@
+/*
+ * Streaming polyphase rational sample rate converter
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include "Resampler.h"
+#include "convolve.h"
+
+Resampler::Resampler(int P, int Q, const signalVector &lpf, int chunk)
+	: mP(P), mQ(Q), mChunk(chunk)
+{
+	int i, n, indx;
+
+	mPartLen = (lpf.size() + P - 1) / P;
+	mDelay = (lpf.size() - 1) / 2 / Q;
+
+	/*
+	 * Partition n holds taps n, n + P, n + 2P, ... stored in reverse
+	 * order so that the dot product walks the input forward.
+	 */
+	mPartitions = new float[2 * P * mPartLen];
+	for (n = 0; n < P; n++) {
+		for (i = 0; i < mPartLen; i++) {
+			indx = n + (mPartLen - 1 - i) * P;
+			mPartitions[2 * (n * mPartLen + i) + 0] =
+				(indx < (int) lpf.size()) ? lpf[indx].real() : 0.0f;
+			mPartitions[2 * (n * mPartLen + i) + 1] = 0.0f;
+		}
+	}
+
+	mBuffer = new float[2 * (mPartLen - 1 + mChunk)];
+
+	reset();
+}
+
+Resampler::~Resampler()
+{
+	delete[] mPartitions;
+	delete[] mBuffer;
+}
+
+void Resampler::reset()
+{
+	memset(mBuffer, 0, 2 * (mPartLen - 1 + mChunk) * sizeof(float));
+
+	mPhase = 0;
+	mIndex = 0;
+	mSkip = mDelay;
+}
+
+/*
+ * Run the filter over the input currently held in the buffer. Each
+ * output consumes Q / P input samples, so the partition index and input
+ * position advance together and carry over into the next call.
+ */
+template <typename T>
+int Resampler::filter(int in_len, T *out, int out_len)
+{
+	int n = 0;
+	float sum[2];
+
+	while (mIndex < in_len) {
+		if (mSkip) {
+			mSkip--;
+		} else {
+			assert(n < out_len);
+			convolve_impl->dot_real(&mBuffer[2 * mIndex],
+						&mPartitions[2 * mPhase * mPartLen],
+						mPartLen, sum);
+			out[2 * n + 0] = (T) sum[0];
+			out[2 * n + 1] = (T) sum[1];
+			n++;
+		}
+
+		mPhase += mQ;
+		mIndex += mPhase / mP;
+		mPhase %= mP;
+	}
+
+	mIndex -= in_len;
+
+	return n;
+}
+
+/* Keep the tail of the input as history for the next call */
+void Resampler::update(int in_len)
+{
+	memmove(mBuffer, &mBuffer[2 * in_len],
+		2 * (mPartLen - 1) * sizeof(float));
+}
+
+/* Load each chunk into the history buffer and filter it */
+template <typename In, typename Out>
+int Resampler::stream(const In *in, int in_len, Out *out, int out_len)
+{
+	int i, len, num_out = 0;
+	float *buf = &mBuffer[2 * (mPartLen - 1)];
+
+	while (in_len > 0) {
+		len = (in_len < mChunk) ? in_len : mChunk;
+
+		for (i = 0; i < 2 * len; i++)
+			buf[i] = in[i];
+
+		num_out += filter(len, &out[2 * num_out], out_len - num_out);
+		update(len);
+
+		in += 2 * len;
+		in_len -= len;
+	}
+
+	return num_out;
+}
+
+int Resampler::rotate(const short *in, int in_len, float *out, int out_len)
+{
+	return stream(in, in_len, out, out_len);
+}
+
+int Resampler::rotate(const float *in, int in_len, short *out, int out_len)
+{
+	return stream(in, in_len, out, out_len);
+}
+
+int Resampler::rotate(const float *in, int in_len, float *out, int out_len)
+{
+	return stream(in, in_len, out, out_len);
+}
@@ -0,0 +1,80 @@
+/*
+ * Streaming polyphase rational sample rate converter
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include "sigProcLib.h"
+
+/*
+ * Resample a continuous stream of interleaved complex samples by P/Q
+ *
+ * The prototype filter is split once into P reversed partitions. Input
+ * samples are converted directly into a history buffer that carries the
+ * filter state across calls, so chunk boundaries are seamless and no
+ * intermediate vectors are created. The filter group delay is removed
+ * by discarding the leading outputs of the stream, which keeps output
+ * sample n aligned with input sample n * Q / P.
+ */
+class Resampler {
+public:
+	/*
+	 * P, Q     - interpolation and decimation factors
+	 * lpf      - real prototype filter designed at P times the input rate
+	 * chunk    - largest number of input samples converted at once
+	 */
+	Resampler(int P, int Q, const signalVector &lpf, int chunk);
+	~Resampler();
+
+	/* Resample int16 input into float output, return outputs written */
+	int rotate(const short *in, int in_len, float *out, int out_len);
+
+	/* Resample float input into int16 output, return outputs written */
+	int rotate(const float *in, int in_len, short *out, int out_len);
+
+	/* Resample float input into float output, return outputs written */
+	int rotate(const float *in, int in_len, float *out, int out_len);
+
+	/* Reset the filter state and output alignment */
+	void reset();
+
+private:
+	int mP;
+	int mQ;
+	int mPartLen;			/* taps per partition */
+	int mChunk;			/* input capacity past the history */
+	int mDelay;			/* group delay in output samples */
+
+	float *mPartitions;		/* P reversed partitions, as complex */
+	float *mBuffer;			/* history followed by new input */
+
+	int mPhase;			/* filter partition of the next output */
+	int mIndex;			/* input index of the next output */
+	int mSkip;			/* leading outputs left to discard */
+
+	template <typename T>
+	int filter(int in_len, T *out, int out_len);
+	void update(int in_len);
+
+	template <typename In, typename Out>
+	int stream(const In *in, int in_len, Out *out, int out_len);
+};
+
+#endif /* RESAMPLER_H */
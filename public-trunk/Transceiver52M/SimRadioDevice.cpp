@@ -0,0 +1,321 @@
+/*
+ * Simulated radio device
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <Logger.h>
+#include "sigProcLib.h"
+#include "SimRadioDevice.h"
+
+#define SIM_RING_MASK		(SIM_RING_LEN - 1)
+
+/* Half length of the fractional delay filter in delayVector(), plus one */
+#define SIM_DELAY_MARGIN	11
+
+/*
+ * delayVector() works on the stack, which is small in the transceiver
+ * threads, so wideband reads are delayed a block at a time
+ */
+#define SIM_DELAY_BLOCK		512
+
+SimRadioDevice::SimRadioDevice(double rate)
+	: rate(rate), tx_freq(0.0), rx_freq(0.0), rx_gain(0.0),
+	  pace(1.0), noise_var(0.0), delay(0.0f), doppler(0.0), loop(true),
+	  file(NULL), tx_end(0), cleared(0), tx_underrun(false), replay(NULL),
+	  rx_start(0), rx_cnt(0), tx_cnt(0)
+{
+	ring = new short[2 * SIM_RING_LEN];
+	memset(ring, 0, 2 * SIM_RING_LEN * sizeof(short));
+}
+
+SimRadioDevice::~SimRadioDevice()
+{
+	delete[] ring;
+	delete replay;
+	free(file);
+}
+
+bool SimRadioDevice::configure(const char *spec)
+{
+	char buf[256], *opt, *save, *val, *end;
+	double num;
+
+	if (strlen(spec) >= sizeof(buf))
+		return false;
+	strcpy(buf, spec);
+
+	for (opt = strtok_r(buf, ",", &save); opt;
+	     opt = strtok_r(NULL, ",", &save)) {
+		val = strchr(opt, '=');
+		if (!val || !val[1])
+			return false;
+		*val++ = '\0';
+
+		if (!strcmp(opt, "file")) {
+			free(file);
+			file = strdup(val);
+			continue;
+		}
+
+		num = strtod(val, &end);
+		if (*end)
+			return false;
+
+		if (!strcmp(opt, "pace") && (num >= 0.0))
+			pace = num;
+		else if (!strcmp(opt, "snr"))
+			noise_var = SIM_FULL_SCALE * SIM_FULL_SCALE /
+				    pow(10.0, num / 10.0) / 2.0;
+		else if (!strcmp(opt, "delay") && (num >= 0.0) &&
+			 (num < SIM_RING_LEN / 4))
+			delay = num;
+		else if (!strcmp(opt, "doppler"))
+			doppler = num;
+		else if (!strcmp(opt, "loopback"))
+			loop = (num != 0.0);
+		else
+			return false;
+	}
+
+	return true;
+}
+
+bool SimRadioDevice::open()
+{
+	LOG(NOTICE) << "simulated radio at " << rate << " sps, pace " << pace
+		    << ", delay " << delay << ", doppler " << doppler << " Hz"
+		    << (noise_var > 0.0 ? ", with noise" : "");
+
+	if (!file)
+		return true;
+
+	replay = new IQReplay;
+	if (!replay->open(file))
+		return false;
+
+	if (replay->rate() && (replay->rate() != rate)) {
+		LOG(WARN) << "recording at " << replay->rate()
+			  << " sps played at " << rate << " sps";
+	}
+
+	return true;
+}
+
+bool SimRadioDevice::start()
+{
+	start_time.now();
+	return true;
+}
+
+bool SimRadioDevice::stop()
+{
+	return true;
+}
+
+/* Wait until the end of the read is due, receive time being the clock */
+void SimRadioDevice::pace_read(TIMESTAMP end, bool *overrun)
+{
+	double due, wait;
+
+	if (pace <= 0.0)
+		return;
+
+	due = (double) (end - initialReadTimestamp()) / (rate * pace);
+	wait = due - (Timeval().seconds() - start_time.seconds());
+
+	if (wait > 0.0)
+		usleep((useconds_t) (wait * 1e6));
+	else if (-wait * rate * pace > SIM_RING_LEN / 2)
+		*overrun = true;
+}
+
+/*
+ * Loop back the transmit samples of one read span. The span is widened
+ * on both sides by the reach of the fractional delay filter, so that
+ * consecutive reads and blocks join up without edges.
+ */
+void SimRadioDevice::loopback(signalVector &out, TIMESTAMP timestamp)
+{
+	int len = out.size();
+	int margin = 0;
+	int idelay = (int) floorf(delay);
+	float fdelay = delay - idelay;
+	long long t, base;
+	unsigned k;
+
+	if (fdelay > 0.0f)
+		margin = SIM_DELAY_MARGIN;
+
+	signalVector sig(len + 2 * margin);
+	signalVector::iterator itr = sig.begin();
+
+	base = (long long) timestamp - idelay - margin;
+
+	lock.lock();
+
+	if (tx_end && (tx_end < timestamp + len))
+		tx_underrun = true;
+
+	for (t = base; t < base + len + 2 * margin; t++) {
+		if (t < 0) {
+			*itr++ = 0.0f;
+			continue;
+		}
+		k = t & SIM_RING_MASK;
+		*itr++ = complex(ring[2 * k + 0], ring[2 * k + 1]);
+	}
+
+	/* Nothing before the start of the next read will be needed again */
+	if ((long long) cleared < base + len) {
+		t = cleared;
+		if (base + len - t > SIM_RING_LEN)
+			t = base + len - SIM_RING_LEN;
+		for (; t < base + len; t++) {
+			k = t & SIM_RING_MASK;
+			ring[2 * k + 0] = 0;
+			ring[2 * k + 1] = 0;
+		}
+		cleared = base + len;
+	}
+
+	lock.unlock();
+
+	if (!margin) {
+		sig.segmentCopyTo(out, 0, len);
+		return;
+	}
+
+	for (int i = 0; i < len; i += SIM_DELAY_BLOCK) {
+		int n = len - i;
+		if (n > SIM_DELAY_BLOCK)
+			n = SIM_DELAY_BLOCK;
+
+		signalVector block(n + 2 * margin);
+		sig.segmentCopyTo(block, i, n + 2 * margin);
+		delayVector(block, fdelay);
+
+		signalVector seg(out.begin(), i, n);
+		block.segmentCopyTo(seg, margin, n);
+	}
+}
+
+int SimRadioDevice::readSamples(short *buf, int len, bool *overrun,
+				TIMESTAMP timestamp, bool *underrun,
+				unsigned *RSSI)
+{
+	float re, im;
+
+	*overrun = false;
+	pace_read(timestamp + len, overrun);
+
+	if (!rx_cnt)
+		rx_start = timestamp;
+
+	signalVector sig(len);
+	signalVector::iterator itr;
+
+	if (loop) {
+		loopback(sig, timestamp);
+	} else {
+		for (itr = sig.begin(); itr != sig.end(); itr++)
+			*itr = 0.0f;
+	}
+
+	if (doppler != 0.0) {
+		double step = 2.0 * M_PI * doppler / rate;
+		double phase = fmod(step * (double) timestamp, 2.0 * M_PI);
+		complex rot(cos(step), sin(step));
+		complex ph(cos(phase), sin(phase));
+
+		for (itr = sig.begin(); itr != sig.end(); itr++) {
+			*itr = *itr * ph;
+			ph = ph * rot;
+		}
+	}
+
+	if (noise_var > 0.0) {
+		signalVector *noise = gaussianNoise(len, noise_var,
+						    complex(0.0, 0.0));
+		addVector(sig, *noise);
+		delete noise;
+	}
+
+	/* The output buffer holds the recording until it is added in */
+	if (replay) {
+		if (replay->read(buf, len, timestamp - rx_start))
+			*overrun = true;
+		itr = sig.begin();
+		for (int i = 0; i < len; i++, itr++)
+			*itr = *itr + complex(buf[2 * i + 0], buf[2 * i + 1]);
+	}
+
+	itr = sig.begin();
+	for (int i = 0; i < len; i++, itr++) {
+		re = itr->real();
+		im = itr->imag();
+		if (re > 32767.0f) re = 32767.0f;
+		if (re < -32768.0f) re = -32768.0f;
+		if (im > 32767.0f) im = 32767.0f;
+		if (im < -32768.0f) im = -32768.0f;
+		buf[2 * i + 0] = (short) re;
+		buf[2 * i + 1] = (short) im;
+	}
+
+	rx_cnt += len;
+	return len;
+}
+
+int SimRadioDevice::writeSamples(short *buf, int len, bool *underrun,
+				 TIMESTAMP timestamp, bool isControl)
+{
+	unsigned k;
+
+	if (isControl) {
+		LOG(ERROR) << "Control packets not supported";
+		return 0;
+	}
+
+	lock.lock();
+
+	/* Samples for a span already read are lost */
+	if (tx_underrun || (timestamp < cleared)) {
+		*underrun = true;
+		tx_underrun = false;
+	}
+
+	for (int i = 0; i < len; i++) {
+		if (timestamp + i < cleared)
+			continue;
+		k = (timestamp + i) & SIM_RING_MASK;
+		ring[2 * k + 0] = buf[2 * i + 0];
+		ring[2 * k + 1] = buf[2 * i + 1];
+	}
+
+	if (timestamp + len > tx_end)
+		tx_end = timestamp + len;
+
+	lock.unlock();
+
+	tx_cnt += len;
+	return len;
+}
@@ -0,0 +1,142 @@
+/*
+ * Simulated radio device
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef SIMRADIODEVICE_H
+#define SIMRADIODEVICE_H
+
+#include <Threads.h>
+#include <Timeval.h>
+#include "radioDevice.h"
+#include "IQFile.h"
+
+class signalVector;
+
+/* Loopback history, about 2.5 seconds at 400 ksps */
+#define SIM_RING_LEN		(1 << 20)
+#define SIM_FULL_SCALE		8192.0
+
+/*
+ * A radio without hardware. Transmitted samples are stored by timestamp
+ * and come back on the receive side at the same timestamp, after the
+ * channel impairments. An optional recording at the device rate, either
+ * a receive capture or raw interleaved int16 IQ, is looped and added to
+ * the received samples so that it can be played against the transceiver.
+ * A capture plays from the first read, as it was recorded, and reads
+ * that overran during the capture overrun again. Started at startFN(),
+ * the transceiver clock runs through the frame numbers of the capture. Tuning and gains are
+ * accepted and otherwise ignored, so the loopback stands in for the
+ * duplex offset as well.
+ *
+ * The spec is a comma separated list of options, all of them optional.
+ *
+ *     pace=<factor>    - run at factor times real time, 0 runs as fast
+ *                        as the transceiver can go, default 1
+ *     snr=<dB>         - add white gaussian noise, relative to full scale
+ *     delay=<samples>  - loopback delay, fractions of a sample allowed
+ *     doppler=<Hz>     - frequency shift of the received signal
+ *     file=<path>      - recorded IQ to add to the received signal
+ *     loopback=0       - receive the recording alone
+ *
+ *     pace=0,snr=20,delay=2.5,doppler=100
+ *     pace=0,loopback=0,file=rx.iq
+ *
+ * Receive time is the only clock. Paced reads wait for their samples to
+ * be due, and a read that finds no transmit samples written for its span
+ * is reported as an underrun on the next write.
+ */
+class SimRadioDevice : public RadioDevice {
+public:
+	SimRadioDevice(double rate);
+	~SimRadioDevice();
+
+	/* Parse the option list, returns false on a malformed spec */
+	bool configure(const char *spec);
+
+	/*
+	 * Frame number for the clock of the transceiver to start at, so
+	 * that an opened capture plays in its original frames, -1 if any
+	 */
+	int startFN() const { return replay ? replay->startFN() : -1; }
+
+	bool open();
+	bool start();
+	bool stop();
+	enum busType getBus() { return USB; }
+	void setPriority() { }
+
+	int readSamples(short *buf, int len, bool *overrun,
+			TIMESTAMP timestamp, bool *underrun, unsigned *RSSI);
+	int writeSamples(short *buf, int len, bool *underrun,
+			 TIMESTAMP timestamp, bool isControl);
+	bool updateAlignment(TIMESTAMP timestamp) { return true; }
+
+	bool setTxFreq(double freq) { tx_freq = freq; return true; }
+	bool setRxFreq(double freq) { rx_freq = freq; return true; }
+
+	TIMESTAMP initialWriteTimestamp() { return 20000; }
+	TIMESTAMP initialReadTimestamp() { return 20000; }
+
+	double fullScaleInputValue() { return SIM_FULL_SCALE; }
+	double fullScaleOutputValue() { return SIM_FULL_SCALE; }
+
+	double setRxGain(double db) { rx_gain = db; return db; }
+	double getRxGain() { return rx_gain; }
+	double maxRxGain() { return 0.0; }
+	double minRxGain() { return 0.0; }
+
+	double setTxGain(double db) { return 0.0; }
+	double maxTxGain() { return 0.0; }
+	double minTxGain() { return 0.0; }
+
+	double getTxFreq() { return tx_freq; }
+	double getRxFreq() { return rx_freq; }
+	double getSampleRate() { return rate; }
+	double numberRead() { return rx_cnt; }
+	double numberWritten() { return tx_cnt; }
+
+private:
+	double rate;
+	double tx_freq, rx_freq;
+	double rx_gain;
+
+	double pace;
+	double noise_var;
+	float delay;
+	double doppler;
+	bool loop;
+	char *file;
+
+	short *ring;
+	TIMESTAMP tx_end;
+	TIMESTAMP cleared;
+	bool tx_underrun;
+	Mutex lock;
+
+	IQReplay *replay;
+	TIMESTAMP rx_start;
+
+	Timeval start_time;
+	long long rx_cnt, tx_cnt;
+
+	void loopback(signalVector &out, TIMESTAMP timestamp);
+	void pace_read(TIMESTAMP end, bool *overrun);
+};
+
+#endif /* SIMRADIODEVICE_H */
@@ -0,0 +1,229 @@
+/*
+ * Scheduling and placement of transceiver threads
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+
+#include <Logger.h>
+#include "ThreadProfile.h"
+
+ThreadProfile gThreadProfile;
+
+ThreadProfile::ThreadProfile()
+	: mLockMemory(false), mNumPlacements(0)
+{
+}
+
+/* Cpu list of single cpus and ranges joined by '+' */
+bool ThreadProfile::parseCPUs(const char *str, cpu_set_t *cpus)
+{
+	char *end;
+	long first, last;
+
+	CPU_ZERO(cpus);
+
+	while (*str) {
+		first = strtol(str, &end, 10);
+		if ((end == str) || (first < 0) || (first >= CPU_SETSIZE))
+			return false;
+
+		last = first;
+		str = end;
+		if (*str == '-') {
+			last = strtol(str + 1, &end, 10);
+			if ((end == str + 1) || (last < first) ||
+			    (last >= CPU_SETSIZE))
+				return false;
+			str = end;
+		}
+
+		for (long i = first; i <= last; i++)
+			CPU_SET(i, cpus);
+
+		if ((*str == '+') && str[1])
+			str++;
+		else if (*str)
+			return false;
+	}
+
+	return CPU_COUNT(cpus) > 0;
+}
+
+bool ThreadProfile::parse(const char *spec)
+{
+	char buf[256], *entry, *save, *field, *end;
+	int min = sched_get_priority_min(SCHED_FIFO);
+	int max = sched_get_priority_max(SCHED_FIFO);
+
+	mLockMemory = false;
+	mNumPlacements = 0;
+
+	if (strlen(spec) >= sizeof(buf))
+		return false;
+	strcpy(buf, spec);
+
+	for (entry = strtok_r(buf, ",", &save); entry;
+	     entry = strtok_r(NULL, ",", &save)) {
+		if (!strcmp(entry, "mlock")) {
+			mLockMemory = true;
+			continue;
+		}
+
+		if (mNumPlacements == MAX_PLACEMENTS)
+			return false;
+		Placement &p = mPlacements[mNumPlacements];
+
+		field = strchr(entry, ':');
+		if (!field || (field == entry) ||
+		    (field - entry >= MAX_ROLE_LEN))
+			return false;
+		*field++ = '\0';
+		strcpy(p.role, entry);
+
+		p.priority = strtol(field, &end, 10);
+		if ((end == field) || (*end && (*end != ':')))
+			return false;
+		if (p.priority && ((p.priority < min) || (p.priority > max)))
+			return false;
+
+		p.pinned = (*end == ':');
+		if (p.pinned && !parseCPUs(end + 1, &p.cpus))
+			return false;
+
+		mNumPlacements++;
+	}
+
+	return true;
+}
+
+void ThreadProfile::lockMemory() const
+{
+	if (!mLockMemory)
+		return;
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		LOG(WARN) << "cannot lock memory: " << strerror(errno);
+		return;
+	}
+
+	LOG(NOTICE) << "locked process memory";
+}
+
+const ThreadProfile::Placement *ThreadProfile::find(const char *role) const
+{
+	const Placement *any = NULL;
+
+	for (int i = 0; i < mNumPlacements; i++) {
+		if (!strcmp(mPlacements[i].role, role))
+			return &mPlacements[i];
+		if (!strcmp(mPlacements[i].role, "*"))
+			any = &mPlacements[i];
+	}
+
+	return any;
+}
+
+void ThreadProfile::apply(const char *role, int chan, int index) const
+{
+	char name[64], comm[16];
+	struct sched_param param;
+	int err;
+
+	if (chan < 0)
+		snprintf(name, sizeof(name), "%s", role);
+	else if (index < 0)
+		snprintf(name, sizeof(name), "%s%d", role, chan);
+	else
+		snprintf(name, sizeof(name), "%s%d.%d", role, chan, index);
+
+	/* The kernel keeps 15 characters of a thread name (16 with the
+	   terminator), so longer names are cut here on purpose */
+	strncpy(comm, name, sizeof(comm) - 1);
+	comm[sizeof(comm) - 1] = '\0';
+	prctl(PR_SET_NAME, comm, 0, 0, 0);
+
+	const Placement *p = find(role);
+	if (!p)
+		return;
+
+	if (p->pinned) {
+		err = pthread_setaffinity_np(pthread_self(),
+					     sizeof(cpu_set_t), &p->cpus);
+		if (err)
+			LOG(WARN) << "cannot pin " << name << ": "
+				  << strerror(err);
+	}
+
+	if (p->priority) {
+		param.sched_priority = p->priority;
+		err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err)
+			LOG(WARN) << "cannot run " << name << " at SCHED_FIFO "
+				  << p->priority << ": " << strerror(err);
+	} else {
+		param.sched_priority = 0;
+		pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	}
+
+	LOG(NOTICE) << name << " at priority " << p->priority
+		    << (p->pinned ? ", pinned" : "");
+}
+
+DeadlineMonitor::DeadlineMonitor(const char *role, int chan, unsigned period)
+	: mPeriod(period), mChecks(0), mMisses(0), mWorst(0), mTotalMisses(0)
+{
+	if (chan < 0)
+		snprintf(mName, sizeof(mName), "%s", role);
+	else
+		snprintf(mName, sizeof(mName), "%s%d", role, chan);
+}
+
+void DeadlineMonitor::missed(long late)
+{
+	mChecks++;
+	mMisses++;
+	mTotalMisses++;
+	if (late > mWorst)
+		mWorst = late;
+
+	report();
+}
+
+void DeadlineMonitor::report()
+{
+	long elapsed = mLastReport.elapsed();
+
+	if (elapsed < (long) mPeriod)
+		return;
+
+	LOG(WARN) << mName << " missed " << mMisses << " of " << mChecks
+		  << " deadlines in " << elapsed << " ms, worst "
+		  << mWorst << " us late";
+
+	mLastReport.now();
+	mChecks = 0;
+	mMisses = 0;
+	mWorst = 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Scheduling and placement of transceiver threads
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef THREADPROFILE_H
+#define THREADPROFILE_H
+
+#include <sched.h>
+#include <Timeval.h>
+
+#define MAX_PLACEMENTS		16
+#define MAX_ROLE_LEN		8
+
+/*
+ * Every transceiver thread names itself after its role and channel
+ * when it starts, then takes the placement the profile gives that
+ * role, if any. Roles are
+ *
+ *     fifo     - radio receive and transmit push, one per channel
+ *     txq      - bursts from the GSM core, one per channel
+ *     rx       - demodulation workers
+ *     ctrl     - control messages from the GSM core
+ *     align    - periodic radio alignment
+ *     async    - device event reporting
+ *
+ * A profile is a comma separated list of role:priority[:cpus] entries.
+ * Priority 0 leaves the thread under the default time sharing policy,
+ * anything else selects SCHED_FIFO at that priority. The optional cpu
+ * list pins the thread, as in "2", "2-3" or "0+2". The role "*" covers
+ * every role without an entry of its own, and the word "mlock" locks
+ * the process memory so that page faults cannot stall the radio path.
+ *
+ *     mlock,fifo:80:1,txq:75:1,rx:70:2-3,*:0:0
+ *
+ * Failures to apply a placement, usually for lack of privileges, are
+ * logged and otherwise ignored.
+ */
+class ThreadProfile {
+public:
+	ThreadProfile();
+
+	/* Replace the profile, returns false on a malformed spec */
+	bool parse(const char *spec);
+
+	/* Lock current and future memory if the profile asks for it */
+	void lockMemory() const;
+
+	/*
+	 * Name the calling thread role, role<chan> or role<chan>.<index>
+	 * and apply the placement of its role
+	 */
+	void apply(const char *role, int chan = -1, int index = -1) const;
+
+private:
+	struct Placement {
+		char role[MAX_ROLE_LEN];
+		int priority;
+		bool pinned;
+		cpu_set_t cpus;
+	};
+
+	bool mLockMemory;
+	int mNumPlacements;
+	Placement mPlacements[MAX_PLACEMENTS];
+
+	const Placement *find(const char *role) const;
+	static bool parseCPUs(const char *str, cpu_set_t *cpus);
+};
+
+extern ThreadProfile gThreadProfile;
+
+/*
+ * Counts the deadlines met and missed by one thread and reports the
+ * misses at most once per period. Misses are reported when the next
+ * deadline is checked after the period has passed, so a thread that
+ * stops missing is reported once more and then stays quiet. Not
+ * thread safe, each monitor belongs to a single thread or lock.
+ */
+class DeadlineMonitor {
+public:
+	DeadlineMonitor(const char *role, int chan = -1,
+			unsigned period = 1000);
+
+	void met()
+	{
+		mChecks++;
+		if (mMisses)
+			report();
+	}
+
+	/* lateness in microseconds */
+	void missed(long late);
+
+	unsigned long long totalMisses() const { return mTotalMisses; }
+
+private:
+	char mName[16];
+	unsigned mPeriod;
+	Timeval mLastReport;
+	unsigned long mChecks;
+	unsigned long mMisses;
+	long mWorst;
+	unsigned long long mTotalMisses;
+
+	void report();
+};
+
+#endif /* THREADPROFILE_H */
@@ -34,18 +34,64 @@
 
 
 
+// Correlation sequences live in the signal processing library,
+//   where the demodulators of every channel share them.
+static Mutex sSequenceLock;
+static bool sRACHReady = false;
+static bool sMidambleReady[8] = {false,false,false,false,false,false,false,false};
+
+// timeslots from b to a
+static int slotsBetween(const GSM::Time &a, const GSM::Time &b)
+{
+  return (a - b)*8 + (int) a.TN() - (int) b.TN();
+}
+
+// a timeslot lasts 15/26 ms
+static long slotsToMicroseconds(int slots)
+{
+  return slots*15000L/26;
+}
+
+// length of a latency in timeslots
+static int slotsOf(const GSM::Time &t)
+{
+  return t.FN()*8 + t.TN();
+}
+
+int SlotHistogram::percentile(float fraction) const
+{
+  unsigned target = (unsigned) ceilf(fraction*mTotal);
+  if (target < 1) target = 1;
+  unsigned sum = 0;
+  for (int i = 0; i < TX_TIMING_SLOTS; i++) {
+    sum += mCounts[i];
+    if (sum >= target) return i;
+  }
+  return TX_TIMING_SLOTS-1;
+}
+
 Transceiver::Transceiver(int wBasePort,
 			 const char *TRXAddress,
 			 int wSamplesPerSymbol,
 			 GSM::Time wTransmitLatency,
-			 RadioInterface *wRadioInterface)
-	:mDataSocket(wBasePort+2,TRXAddress,wBasePort+102),
-	 mControlSocket(wBasePort+1,TRXAddress,wBasePort+101),
-	 mClockSocket(wBasePort,TRXAddress,wBasePort+100)
+			 RadioInterface *wRadioInterface,
+			 int wRxWorkers,
+			 int wChannel,
+			 int wStartFN)
+	:mDataSocket(wBasePort+2+2*wChannel,TRXAddress,wBasePort+102+2*wChannel),
+	 mControlSocket(wBasePort+1+2*wChannel,TRXAddress,wBasePort+101+2*wChannel),
+	 mClockSocket(wChannel ? 0 : wBasePort,TRXAddress,wBasePort+100),
+	 mDataShm(NULL),mUseShm(false),
+	 mRxBurstBits(gSlotLen),mTxBurstBits(gSlotLen),
+	 mTxDeadlines("fifo",wChannel),mRxDeadlines("rx",wChannel)
 {
   //GSM::Time startTime(0,0);
   //GSM::Time startTime(gHyperframe/2 - 4*216*60,0);
   GSM::Time startTime(random() % gHyperframe,0);
+  // a replay starts at the frame its recording started at
+  if (wStartFN >= 0) startTime = GSM::Time(wStartFN % gHyperframe,0);
+  // other channels of the radio follow the clock set by channel 0
+  if (wChannel) startTime = wRadioInterface->getClock()->get();
 
   mFIFOServiceLoopThread = new Thread(32768);  ///< thread to push bursts into transmit FIFO
   mControlServiceLoopThread = new Thread(32768);       ///< thread to process control messages from GSM core
@@ -54,17 +100,42 @@ Transceiver::Transceiver(int wBasePort,
 
   mSamplesPerSymbol = wSamplesPerSymbol;
   mRadioInterface = wRadioInterface;
+  mChannel = wChannel;
   mTransmitLatency = wTransmitLatency;
+  // USB radios could always go down to a frame and a slot, others keep the initial latency
+  mMinTransmitLatency = GSM::Time(1,1);
+  if (mRadioInterface->getBus() != RadioDevice::USB) mMinTransmitLatency = wTransmitLatency;
   mTransmitDeadlineClock = startTime;
   mLastClockUpdateTime = startTime;
   mLatencyUpdateTime = startTime;
-  mRadioInterface->getClock()->set(startTime);
+  mLatencyWindowStart = startTime;
+  mLatencyGuard = 1;
+  mWindowUnderrun = false;
+  mLatencyFloor = slotsOf(mTransmitLatency);
+  mLatencyCeiling = -1;
+  mTxUnderruns = 0;
+  if (!mChannel) mRadioInterface->getClock()->set(startTime);
   mMaxExpectedDelay = 0;
+  mBurstBatch = 1;
+  mRxBatchCount = 0;
+  mRxBatchFN = 0;
+  mRxBatchFormat = RX_BYTES;
+
+  mNumRxWorkers = wRxWorkers;
+  if (mNumRxWorkers < 1) mNumRxWorkers = 1;
+  if (mNumRxWorkers > MAX_RX_WORKERS) mNumRxWorkers = MAX_RX_WORKERS;
+  for (int i = 0; i < mNumRxWorkers; i++) {
+    mRxWorkers[i].trx = this;
+    mRxWorkers[i].index = i;
+  }
+  mRxHead = 0;
+  mRxTail = 0;
 
   // generate pulse and setup up signal processing library
   gsmPulse = generateGSMPulse(2,mSamplesPerSymbol);
   LOG(DEBUG) << "gsmPulse: " << *gsmPulse;
-  sigProcLibSetup(mSamplesPerSymbol);
+  // the signal processing library is shared by all channels of the radio
+  if (!mChannel) sigProcLibSetup(mSamplesPerSymbol);
 
   txFullScale = mRadioInterface->fullScaleInputValue();
   rxFullScale = mRadioInterface->fullScaleOutputValue();
@@ -76,14 +147,18 @@ Transceiver::Transceiver(int wBasePort,
 					   mSamplesPerSymbol);
     scaleVector(*modBurst,txFullScale);
     fillerModulus[i]=26;
+    // every frame of the slot shares the same dummy waveform
+    sharedVector *dummyBurst = new sharedVector(*modBurst);
     for (int j = 0; j < 102; j++) {
-      fillerTable[j][i] = new signalVector(*modBurst);
+      dummyBurst->incRef();
+      fillerTable[j][i] = dummyBurst;
     }
+    dummyBurst->decRef();
     delete modBurst;
     mChanType[i] = NONE;
-    channelResponse[i] = NULL;
-    DFEForward[i] = NULL;
-    DFEFeedback[i] = NULL;
+    mRxFormat[i] = RX_BYTES;
+    DFEValid[i] = false;
+    DFEFeedbackLen[i] = 0;
     channelEstimateTime[i] = startTime;
   }
 
@@ -98,8 +173,17 @@ Transceiver::Transceiver(int wBasePort,
 Transceiver::~Transceiver()
 {
   delete gsmPulse;
-  sigProcLibDestroy();
+  if (!mChannel) {
+    sigProcLibDestroy();
+    sRACHReady = false;
+    for (int i = 0; i < 8; i++) sMidambleReady[i] = false;
+  }
   mTransmitPriorityQueue.clear();
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < 102; j++) 
+      fillerTable[j][i]->decRef();
+  }
+  delete mDataShm;
 }
   
 
@@ -107,15 +191,31 @@ void Transceiver::addRadioVector(BitVector &burst,
 				 int RSSI,
 				 GSM::Time &wTime)
 {
-  // modulate and stick into queue 
-  signalVector* modBurst = modulateBurst(burst,*gsmPulse,
-					 8 + (wTime.TN() % 4 == 0),
-					 mSamplesPerSymbol);
-  scaleVector(*modBurst,txFullScale * pow(10,-RSSI/10));
-  radioVector *newVec = new radioVector(*modBurst,wTime);
+  // repeated bursts (dummy, BCCH, idle fill) reuse an earlier modulation
+  sharedVector *modBurst = mBurstCache.find(burst,wTime.TN(),RSSI);
+
+  if (!modBurst) {
+    signalVector* burstSamples = modulateBurst(burst,*gsmPulse,
+					       8 + (wTime.TN() % 4 == 0),
+					       mSamplesPerSymbol);
+    scaleVector(*burstSamples,txFullScale * pow(10,-RSSI/10));
+    modBurst = new sharedVector(*burstSamples);
+    mBurstCache.insert(burst,wTime.TN(),RSSI,modBurst);
+    delete burstSamples;
+  }
+
+  // how far ahead of the radio clock the GSM core delivered the burst
+  int margin = slotsBetween(wTime,mRadioInterface->getClock()->get());
+  mTxStatsLock.lock();
+  mTxArrival.add(margin);
+  if (margin < slotsOf(mTransmitLatency)) mTxStats[wTime.TN()].late++;
+  mTxStatsLock.unlock();
+
+  // stick into queue
+  radioVector *newVec = new radioVector(modBurst,wTime);
   mTransmitPriorityQueue.write(newVec);
 
-  delete modBurst;
+  modBurst->decRef();
 }
 
 #ifdef TRANSMIT_LOGGING
@@ -151,9 +251,13 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
     LOG(NOTICE) << "dumping STALE burst in TRX->USRP interface";
     const GSM::Time& nextTime = staleBurst->getTime();
     int TN = nextTime.TN();
+    mTxStatsLock.lock();
+    mTxStats[TN].dropped++;
+    mTxStatsLock.unlock();
     int modFN = nextTime.FN() % fillerModulus[TN];
-    delete fillerTable[modFN][TN];
-    fillerTable[modFN][TN] = staleBurst;
+    fillerTable[modFN][TN]->decRef();
+    fillerTable[modFN][TN] = staleBurst->share();
+    delete staleBurst;
   }
   
   int TN = nowTime.TN();
@@ -162,9 +266,12 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
   // if queue contains data at the desired timestamp, stick it into FIFO
   if (radioVector *next = (radioVector*) mTransmitPriorityQueue.getCurrentBurst(nowTime)) {
     LOG(DEBUG) << "transmitFIFO: wrote burst " << next << " at time: " << nowTime;
-    delete fillerTable[modFN][TN];
-    fillerTable[modFN][TN] = new signalVector(*(next));
-    mRadioInterface->driveTransmitRadio(*(next),(mChanType[TN]==NONE)); //fillerTable[modFN][TN]));
+    mTxStatsLock.lock();
+    mTxStats[TN].sent++;
+    mTxStatsLock.unlock();
+    fillerTable[modFN][TN]->decRef();
+    fillerTable[modFN][TN] = next->share();
+    mRadioInterface->driveTransmitRadio(*(next),(mChanType[TN]==NONE),mChannel); //fillerTable[modFN][TN]));
     delete next;
 #ifdef TRANSMIT_LOGGING
     if (nowTime.TN()==TRANSMIT_LOGGING) { 
@@ -175,7 +282,10 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
   }
 
   // otherwise, pull filler data, and push to radio FIFO
-  mRadioInterface->driveTransmitRadio(*(fillerTable[modFN][TN]),(mChanType[TN]==NONE));
+  mTxStatsLock.lock();
+  mTxStats[TN].filled++;
+  mTxStatsLock.unlock();
+  mRadioInterface->driveTransmitRadio(*(fillerTable[modFN][TN]),(mChanType[TN]==NONE),mChannel);
 #ifdef TRANSMIT_LOGGING
   if (nowTime.TN()==TRANSMIT_LOGGING) 
     unModulateVector(*fillerTable[modFN][TN]);
@@ -276,62 +386,82 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 				      int &RSSI,
 				      int &timingOffset)
 {
-  bool needDFE = (mMaxExpectedDelay > 1);
-
   radioVector *rxBurst = (radioVector *) mReceiveFIFO->get();
 
   if (!rxBurst) return NULL;
 
   LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
 
-  int timeslot = rxBurst->getTime().TN();
-
   CorrType corrType = expectedCorrType(rxBurst->getTime());
 
   if ((corrType==OFF) || (corrType==IDLE)) {
     delete rxBurst;
     return NULL;
   }
- 
+
+  SoftVector *burst = NULL;
+  if (demodulateRadioVector(*rxBurst,corrType,mRxBurstBits,RSSI,timingOffset)) {
+    burst = &mRxBurstBits;
+    wTime = rxBurst->getTime();
+  }
+
+  delete rxBurst;
+
+  return burst;
+}
+
+bool Transceiver::demodulateRadioVector(radioVector &rxBurst,
+					CorrType corrType,
+					SoftVector &bits,
+					int &RSSI,
+					int &timingOffset)
+{
+  bool needDFE = (mMaxExpectedDelay > 1);
+
+  int timeslot = rxBurst.getTime().TN();
+
   // check to see if received burst has sufficient 
-  signalVector *vectorBurst = rxBurst;
+  signalVector *vectorBurst = &rxBurst;
+#ifdef FIXED_POINT_RX
+  // detect and demodulate on 16-bit samples, only the equalizer uses float
+  complex16 fixedData[rxBurst.size()];
+  fixedVector detectBurst(fixedData,rxBurst.size());
+  quantizeVector(rxBurst,detectBurst);
+#else
+  signalVector &detectBurst = rxBurst;
+#endif
   complex amplitude = 0.0;
   float TOA = 0.0;
   float avgPwr = 0.0;
-  if (!energyDetect(*vectorBurst,20*mSamplesPerSymbol,mEnergyThreshold,&avgPwr)) {
-     LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst->getTime();
-     double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
+  mRxStateLock.lock();
+  float energyThreshold = mEnergyThreshold;
+  mRxStateLock.unlock();
+  if (!energyDetect(detectBurst,20*mSamplesPerSymbol,energyThreshold,&avgPwr)) {
+     LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst.getTime();
+     mRxStateLock.lock();
+     double framesElapsed = rxBurst.getTime()-prevFalseDetectionTime;
      if (framesElapsed > 50) {  // if we haven't had any false detections for a while, lower threshold
 	mEnergyThreshold -= 10.0/10.0;
         if (mEnergyThreshold < 0.0)
           mEnergyThreshold = 0.0;
 
-        prevFalseDetectionTime = rxBurst->getTime();
+        prevFalseDetectionTime = rxBurst.getTime();
      }
-     delete rxBurst;
-     return NULL;
+     mRxStateLock.unlock();
+     return false;
   }
-  LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst->getTime();
+  LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst.getTime();
 
   // run the proper correlator
   bool success = false;
   if (corrType==TSC) {
-    LOG(DEBUG) << "looking for TSC at time: " << rxBurst->getTime();
+    LOG(DEBUG) << "looking for TSC at time: " << rxBurst.getTime();
     signalVector *channelResp;
-    double framesElapsed = rxBurst->getTime()-channelEstimateTime[timeslot];
-    bool estimateChannel = false;
-    if ((framesElapsed > 50) || (channelResponse[timeslot]==NULL)) {
-	if (channelResponse[timeslot]) delete channelResponse[timeslot];
-        if (DFEForward[timeslot]) delete DFEForward[timeslot];
-        if (DFEFeedback[timeslot]) delete DFEFeedback[timeslot];
-        channelResponse[timeslot] = NULL;
-        DFEForward[timeslot] = NULL;
-        DFEFeedback[timeslot] = NULL;
-	estimateChannel = true;
-    }
-    if (!needDFE) estimateChannel = false;
+    // the DFE is tracked from burst to burst, the channel is only
+    //   estimated again when there are no filters to track
+    bool estimateChannel = needDFE && !DFEValid[timeslot];
     float chanOffset;
-    success = analyzeTrafficBurst(*vectorBurst,
+    success = analyzeTrafficBurst(detectBurst,
 				  mTSC,
 				  3.0,
 				  mSamplesPerSymbol,
@@ -343,77 +473,191 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 				  &chanOffset);
     if (success) {
       LOG(DEBUG) << "FOUND TSC!!!!!! " << amplitude << " " << TOA;
+      mRxStateLock.lock();
       mEnergyThreshold -= 1.0F/10.0F;
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
       SNRestimate[timeslot] = amplitude.norm2()/(mEnergyThreshold*mEnergyThreshold+1.0); // this is not highly accurate
+      mRxStateLock.unlock();
       if (estimateChannel) {
-         LOG(DEBUG) << "estimating channel...";
-         channelResponse[timeslot] = channelResp;
+         LOG(DEBUG) << "estimating channel, " << rxBurst.getTime()-channelEstimateTime[timeslot] << " frames since the last estimate";
        	 chanRespOffset[timeslot] = chanOffset;
          chanRespAmplitude[timeslot] = amplitude;
 	 scaleVector(*channelResp, complex(1.0,0.0)/amplitude);
-         designDFE(*channelResp, SNRestimate[timeslot], 7, &DFEForward[timeslot], &DFEFeedback[timeslot]);
-         channelEstimateTime[timeslot] = rxBurst->getTime();  
-         LOG(DEBUG) << "SNR: " << SNRestimate[timeslot] << ", DFE forward: " << *DFEForward[timeslot] << ", DFE backward: " << *DFEFeedback[timeslot];
+         DFEFeedbackLen[timeslot] = channelResp->size()-1;
+         signalVector w(DFEForward[timeslot],0,DFE_FORWARD_TAPS);
+         signalVector b(DFEFeedback[timeslot],0,DFEFeedbackLen[timeslot]);
+         DFEValid[timeslot] = designDFE(*channelResp, SNRestimate[timeslot], w, b);
+         delete channelResp;
+         channelEstimateTime[timeslot] = rxBurst.getTime();  
+         LOG(DEBUG) << "SNR: " << SNRestimate[timeslot] << ", DFE forward: " << w << ", DFE backward: " << b;
       }
     }
     else {
-      double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime; 
-      LOG(DEBUG) << "wTime: " << rxBurst->getTime() << ", pTime: " << prevFalseDetectionTime << ", fElapsed: " << framesElapsed;
+      mRxStateLock.lock();
+      double framesElapsed = rxBurst.getTime()-prevFalseDetectionTime; 
+      LOG(DEBUG) << "wTime: " << rxBurst.getTime() << ", pTime: " << prevFalseDetectionTime << ", fElapsed: " << framesElapsed;
       mEnergyThreshold += 10.0F/10.0F*exp(-framesElapsed);
-      prevFalseDetectionTime = rxBurst->getTime();
-      channelResponse[timeslot] = NULL;
+      prevFalseDetectionTime = rxBurst.getTime();
+      mRxStateLock.unlock();
+      DFEValid[timeslot] = false;
     }
   }
   else {
     // RACH burst
-    success = detectRACHBurst(*vectorBurst,
+    success = detectRACHBurst(detectBurst,
 			      5.0,  // detection threshold
 			      mSamplesPerSymbol,
 			      &amplitude,
 			      &TOA);
+    mRxStateLock.lock();
     if (success) {
       LOG(DEBUG) << "FOUND RACH!!!!!! " << amplitude << " " << TOA;
       mEnergyThreshold -= (1.0F/10.0F);
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
-      channelResponse[timeslot] = NULL; 
+      DFEValid[timeslot] = false;
     }
     else {
-      double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
+      double framesElapsed = rxBurst.getTime()-prevFalseDetectionTime;
       mEnergyThreshold += (1.0F/10.0F)*exp(-framesElapsed);
-      prevFalseDetectionTime = rxBurst->getTime();
+      prevFalseDetectionTime = rxBurst.getTime();
     }
+    mRxStateLock.unlock();
   }
   LOG(DEBUG) << "energy Threshold = " << mEnergyThreshold; 
 
-  // demodulate burst
-  SoftVector *burst = NULL;
-  if ((rxBurst) && (success)) {
-    if ((corrType==RACH) || (!needDFE)) {
-      burst = demodulateBurst(*vectorBurst,
-			      *gsmPulse,
-			      mSamplesPerSymbol,
-			      amplitude,TOA);
+  if (!success) return false;
+
+  // demodulate burst into the caller's bit buffer
+  if ((corrType==RACH) || (!needDFE) || (!DFEValid[timeslot])) {
+#ifdef FIXED_POINT_RX
+    if (!demodulateBurst(detectBurst,
+			 mSamplesPerSymbol,
+			 amplitude,TOA,
+			 bits)) return false;
+#else
+    if (!demodulateBurst(*vectorBurst,
+			 *gsmPulse,
+			 mSamplesPerSymbol,
+			 amplitude,TOA,
+			 bits)) return false;
+#endif
+  }
+  else { // TSC
+    signalVector w(DFEForward[timeslot],0,DFE_FORWARD_TAPS);
+    signalVector b(DFEFeedback[timeslot],0,DFEFeedbackLen[timeslot]);
+    scaleVector(*vectorBurst,complex(1.0,0.0)/amplitude);
+    if (!equalizeBurst(*vectorBurst,
+		       TOA-chanRespOffset[timeslot],
+		       mSamplesPerSymbol,
+		       w,
+		       b,
+		       bits)) return false;
+    // follow the channel on this burst's midamble for the next one
+    float trainingError = 0.0;
+    if (!trackDFE(*vectorBurst,bits,mTSC,DFE_STEP_SIZE,w,b,&trainingError) ||
+        (trainingError > DFE_MAX_TRAINING_ERROR)) {
+      LOG(DEBUG) << "DFE lost track, training error " << trainingError;
+      DFEValid[timeslot] = false;
     }
-    else { // TSC
-      scaleVector(*vectorBurst,complex(1.0,0.0)/amplitude);
-      burst = equalizeBurst(*vectorBurst,
-			    TOA-chanRespOffset[timeslot],
-			    mSamplesPerSymbol,
-			    *DFEForward[timeslot],
-			    *DFEFeedback[timeslot]);
+  }
+  RSSI = (int) floor(20.0*log10(rxFullScale/amplitude.abs()));
+  LOG(DEBUG) << "RSSI: " << RSSI;
+  timingOffset = (int) round(TOA*256.0/mSamplesPerSymbol);
+
+  //LOG(DEEPDEBUG) << "burst: " << bits << '\n';
+
+  return true;
+}
+
+void Transceiver::dispatchRadioVectors()
+{
+  writeRxJobs();
+
+  while (true) {
+    // leave bursts in the receive FIFO while the pipeline is full,
+    //   rather than holding up the radio until a worker finishes
+    mRxLock.lock();
+    bool full = (mRxJobs[mRxTail].state != RX_FREE);
+    mRxLock.unlock();
+    if (full) break;
+
+    radioVector *rxBurst = mReceiveFIFO->get();
+    if (!rxBurst) break;
+
+    LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
+
+    CorrType corrType = expectedCorrType(rxBurst->getTime());
+
+    if ((corrType==OFF) || (corrType==IDLE)) {
+      delete rxBurst;
+      continue;
     }
-    wTime = rxBurst->getTime();
-    RSSI = (int) floor(20.0*log10(rxFullScale/amplitude.abs()));
-    LOG(DEBUG) << "RSSI: " << RSSI;
-    timingOffset = (int) round(TOA*256.0/mSamplesPerSymbol);
+
+    mRxLock.lock();
+    RxJob &job = mRxJobs[mRxTail];
+    job.burst = rxBurst;
+    job.corrType = corrType;
+    job.time = rxBurst->getTime();
+    job.state = RX_PENDING;
+    mRxTail = (mRxTail+1) % RX_PIPELINE_DEPTH;
+    mRxSignal.broadcast();
+    mRxLock.unlock();
   }
 
-  //if (burst) LOG(DEEPDEBUG) << "burst: " << *burst << '\n';
+  writeRxJobs();
+}
 
-  delete rxBurst;
+void Transceiver::writeRxJobs()
+{
+  // The receive FIFO is in time order, and so is the pipeline.
+  // A finished burst waits here until all earlier ones are done.
+  while (true) {
+    mRxLock.lock();
+    RxJob &job = mRxJobs[mRxHead];
+    bool done = (job.state == RX_DONE);
+    mRxLock.unlock();
+    if (!done) return;
+
+    if (job.valid) writeRxBurst(job.bits,job.time,job.RSSI,job.timingOffset);
+
+    mRxLock.lock();
+    job.state = RX_FREE;
+    mRxHead = (mRxHead+1) % RX_PIPELINE_DEPTH;
+    mRxSignal.broadcast();
+    mRxLock.unlock();
+  }
+}
 
-  return burst;
+void Transceiver::driveRxWorker(int index)
+{
+  RxJob *job = NULL;
+
+  // take the oldest burst of this worker's timeslots, so that
+  //   each timeslot is demodulated in order by a single thread
+  mRxLock.lock();
+  while (!job) {
+    for (unsigned i = 0; i < RX_PIPELINE_DEPTH; i++) {
+      RxJob &next = mRxJobs[(mRxHead+i) % RX_PIPELINE_DEPTH];
+      if ((next.state == RX_PENDING) &&
+          ((int) next.time.TN() % mNumRxWorkers == index)) {
+        job = &next;
+        break;
+      }
+    }
+    if (!job) mRxSignal.wait(mRxLock);
+  }
+  job->state = RX_BUSY;
+  mRxLock.unlock();
+
+  job->valid = demodulateRadioVector(*job->burst,job->corrType,
+                                     job->bits,job->RSSI,job->timingOffset);
+  delete job->burst;
+  job->burst = NULL;
+
+  mRxLock.lock();
+  job->state = RX_DONE;
+  mRxSignal.broadcast();
+  mRxLock.unlock();
 }
 
 void Transceiver::start()
@@ -429,6 +673,17 @@ void Transceiver::reset()
 }
 
   
+void Transceiver::generateSequences(int TSC)
+{
+  sSequenceLock.lock();
+  if (TSC < 0) {
+    if (!sRACHReady) sRACHReady = generateRACHSequence(*gsmPulse,mSamplesPerSymbol);
+  }
+  else if ((TSC < 8) && !sMidambleReady[TSC])
+    sMidambleReady[TSC] = generateMidamble(*gsmPulse,mSamplesPerSymbol,TSC);
+  sSequenceLock.unlock();
+}
+
 void Transceiver::driveControl()
 {
 
@@ -472,8 +727,14 @@ void Transceiver::driveControl()
       if (!mOn) {
         // Prepare for thread start
         mPower = -20;
-        mRadioInterface->start();
-        generateRACHSequence(*gsmPulse,mSamplesPerSymbol);
+        mRadioInterface->start(mChannel);
+        generateSequences(-1);
+
+        // Start demodulator threads.
+        if (mNumRxWorkers > 1) {
+          for (int i = 0; i < mNumRxWorkers; i++)
+            mRxWorkers[i].thread.start((void * (*)(void*))RxWorkerLoopAdapter,(void*) &mRxWorkers[i]);
+        }
 
         // Start radio interface threads.
         mFIFOServiceLoopThread->start((void * (*)(void*))FIFOServiceLoopAdapter,(void*) this);
@@ -515,7 +776,7 @@ void Transceiver::driveControl()
       sprintf(response,"RSP SETPOWER 1 %d",dbPwr);
     else {
       mPower = dbPwr;
-      mRadioInterface->setPowerAttenuation(dbPwr);
+      mRadioInterface->setPowerAttenuation(dbPwr,mChannel);
       sprintf(response,"RSP SETPOWER 0 %d",dbPwr);
     }
   }
@@ -536,7 +797,7 @@ void Transceiver::driveControl()
     int freqKhz;
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
     mRxFreq = freqKhz*1.0e3+FREQOFFSET;
-    if (!mRadioInterface->tuneRx(mRxFreq)) {
+    if (!mRadioInterface->tuneRx(mRxFreq,mChannel)) {
        LOG(ALARM) << "RX failed to tune";
        sprintf(response,"RSP RXTUNE 1 %d",freqKhz);
     }
@@ -549,7 +810,7 @@ void Transceiver::driveControl()
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
     //freqKhz = 890e3;
     mTxFreq = freqKhz*1.0e3+FREQOFFSET;
-    if (!mRadioInterface->tuneTx(mTxFreq)) {
+    if (!mRadioInterface->tuneTx(mTxFreq,mChannel)) {
        LOG(ALARM) << "TX failed to tune";
        sprintf(response,"RSP TXTUNE 1 %d",freqKhz);
     }
@@ -564,7 +825,7 @@ void Transceiver::driveControl()
       sprintf(response,"RSP SETTSC 1 %d",TSC);
     else {
       mTSC = TSC;
-      generateMidamble(*gsmPulse,mSamplesPerSymbol,TSC);
+      generateSequences(TSC);
       sprintf(response,"RSP SETTSC 0 %d",TSC);
     }
   }
@@ -583,8 +844,82 @@ void Transceiver::driveControl()
     sprintf(response,"RSP SETSLOT 0 %d %d",timeslot,corrCode);
 
   }
+  else if (strcmp(command,"SETBATCH")==0) {
+    // set number of bursts per data packet
+    int count;
+    sscanf(buffer,"%3s %s %d",cmdcheck,command,&count);
+    if (count < 1) count = 1;
+    if (count > MAX_BURST_BATCH) count = MAX_BURST_BATCH;
+    mBurstBatch = count;
+    sprintf(response,"RSP SETBATCH 0 %d",count);
+  }
+  else if (strcmp(command,"SETRXFMT")==0) {
+    // set soft bit format of received bursts
+    int timeslot;
+    int format;
+    sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&timeslot,&format);
+    if ((timeslot < 0) || (timeslot > 7) || (format < RX_BYTES) || (format > RX_HARD)) {
+      LOG(WARN) << "bogus message on control interface";
+      sprintf(response,"RSP SETRXFMT 1 %d %d",timeslot,format);
+    }
+    else {
+      mRxFormat[timeslot] = (RxFormat) format;
+      sprintf(response,"RSP SETRXFMT 0 %d %d",timeslot,format);
+    }
+  }
+  else if (strcmp(command,"TXSTATS")==0) {
+    // report the transmit burst accounting of a timeslot
+    int timeslot;
+    sscanf(buffer,"%3s %s %d",cmdcheck,command,&timeslot);
+    if ((timeslot < 0) || (timeslot > 7)) {
+      LOG(WARN) << "bogus message on control interface";
+      sprintf(response,"RSP TXSTATS 1 %d",timeslot);
+    }
+    else {
+      mTxStatsLock.lock();
+      TxSlotStats stats = mTxStats[timeslot];
+      mTxStatsLock.unlock();
+      sprintf(response,"RSP TXSTATS 0 %d %u %u %u %u",timeslot,
+              stats.sent,stats.late,stats.dropped,stats.filled);
+    }
+  }
+  else if (strcmp(command,"TXLATENCY")==0) {
+    // report the transmit latency and the bounds measured for it
+    mTxStatsLock.lock();
+    sprintf(response,"RSP TXLATENCY 0 %d %d %d %u",slotsOf(mTransmitLatency),
+            mLatencyFloor,mLatencyCeiling,mTxUnderruns);
+    mTxStatsLock.unlock();
+  }
+  else if (strcmp(command,"SHMDATA")==0) {
+    // move the data interface to a shared memory channel created by the core
+    char name[MAX_PACKET_LENGTH];
+    name[0] = '\0';
+    sscanf(buffer,"%3s %s %s",cmdcheck,command,name);
+    if (!mDataShm) {
+      ShmSocket *shm = new ShmSocket(name,false);
+      if (shm->valid()) mDataShm = shm;
+      else delete shm;
+    }
+    if (!mDataShm) {
+      LOG(WARN) << "cannot attach shared memory data channel " << name;
+      sprintf(response,"RSP SHMDATA 1");
+    }
+    else {
+      // publish mDataShm before the threads that test mUseShm see it
+      __sync_synchronize();
+      mUseShm = true;
+      __sync_synchronize();
+      sprintf(response,"RSP SHMDATA 0");
+      mControlSocket.write(response,strlen(response)+1);
+      // an empty batch wakes the core reader still waiting on the socket
+      char empty = 0;
+      mDataSocket.write(&empty,1);
+      return;
+    }
+  }
   else {
     LOG(WARN) << "bogus command " << command << " on control interface.";
+    sprintf(response,"RSP ERR 1");
   }
 
   mControlSocket.write(response,strlen(response)+1);
@@ -594,58 +929,70 @@ void Transceiver::driveControl()
 bool Transceiver::driveTransmitPriorityQueue() 
 {
 
-  char buffer[gSlotLen+50];
-
-  // check data socket
-  size_t msgLen = mDataSocket.read(buffer);
-
-  if (msgLen!=gSlotLen+1+4+1) {
-    LOG(ERROR) << "badly formatted packet on GSM->TRX interface";
-    return false;
+  static const unsigned recordLen = gSlotLen+1+4+1;
+  char buffer[MAX_UDP_LENGTH];
+
+  // check data socket, the barrier pairs with the one in the SHMDATA handler
+  bool useShm = mUseShm;
+  __sync_synchronize();
+  size_t msgLen = useShm ? mDataShm->read(buffer) : mDataSocket.read(buffer);
+  if (useShm) LOG(DEEPDEBUG) << "packet spent " << mDataShm->lastDelay() << " us in shared memory";
+
+  // either one burst, or a count followed by that many bursts
+  char *record = buffer;
+  unsigned count = 1;
+  if (msgLen!=recordLen) {
+    count = (unsigned char) buffer[0];
+    record = buffer+1;
+    if ((count > MAX_BURST_BATCH) || (msgLen!=1+count*recordLen)) {
+      LOG(ERROR) << "badly formatted packet on GSM->TRX interface";
+      return false;
+    }
   }
 
-  int timeSlot = (int) buffer[0];
-  uint64_t frameNum = 0;
-  for (int i = 0; i < 4; i++)
-    frameNum = (frameNum << 8) | (0x0ff & buffer[i+1]);
-  
-  /*
-  if (GSM::Time(frameNum,timeSlot) >  mTransmitDeadlineClock + GSM::Time(51,0)) {
-    // stale burst
-    //LOG(DEBUG) << "FAST! "<< GSM::Time(frameNum,timeSlot);
-    //writeClockInterface();
-    }*/
-
-/*
-  DAB -- Just let these go through the demod.
-  if (GSM::Time(frameNum,timeSlot) < mTransmitDeadlineClock) {
-    // stale burst from GSM core
-    LOG(NOTICE) << "STALE packet on GSM->TRX interface at time "<< GSM::Time(frameNum,timeSlot);
-    return false;
-  }
-*/
-  
   // periodically update GSM core clock
   LOG(DEEPDEBUG) << "mTransmitDeadlineClock " << mTransmitDeadlineClock
 		<< " mLastClockUpdateTime " << mLastClockUpdateTime;
   if (mTransmitDeadlineClock > mLastClockUpdateTime + GSM::Time(216,0))
     writeClockInterface();
 
+  for (unsigned n = 0; n < count; n++, record += recordLen) {
+
+    int timeSlot = (int) record[0];
+    uint64_t frameNum = 0;
+    for (int i = 0; i < 4; i++)
+      frameNum = (frameNum << 8) | (0x0ff & record[i+1]);
+  
+    /*
+    if (GSM::Time(frameNum,timeSlot) >  mTransmitDeadlineClock + GSM::Time(51,0)) {
+      // stale burst
+      //LOG(DEBUG) << "FAST! "<< GSM::Time(frameNum,timeSlot);
+      //writeClockInterface();
+      }*/
+
+/*
+    DAB -- Just let these go through the demod.
+    if (GSM::Time(frameNum,timeSlot) < mTransmitDeadlineClock) {
+      // stale burst from GSM core
+      LOG(NOTICE) << "STALE packet on GSM->TRX interface at time "<< GSM::Time(frameNum,timeSlot);
+      return false;
+    }
+*/
 
-  LOG(DEEPDEBUG) << "rcvd. burst at: " << GSM::Time(frameNum,timeSlot);
+    LOG(DEEPDEBUG) << "rcvd. burst at: " << GSM::Time(frameNum,timeSlot);
   
-  int RSSI = (int) buffer[5];
-  static BitVector newBurst(gSlotLen);
-  BitVector::iterator itr = newBurst.begin();
-  char *bufferItr = buffer+6;
-  while (itr < newBurst.end()) 
-    *itr++ = *bufferItr++;
+    int RSSI = (int) record[5];
+    BitVector::iterator itr = mTxBurstBits.begin();
+    char *bufferItr = record+6;
+    while (itr < mTxBurstBits.end()) 
+      *itr++ = *bufferItr++;
   
-  GSM::Time currTime = GSM::Time(frameNum,timeSlot);
+    GSM::Time currTime = GSM::Time(frameNum,timeSlot);
   
-  addRadioVector(newBurst,RSSI,currTime);
+    addRadioVector(mTxBurstBits,RSSI,currTime);
   
-  LOG(DEEPDEBUG) "added burst - time: " << currTime << ", RSSI: " << RSSI; // << ", data: " << newBurst; 
+    LOG(DEEPDEBUG) "added burst - time: " << currTime << ", RSSI: " << RSSI; // << ", data: " << newBurst; 
+  }
 
   return true;
 
@@ -662,34 +1009,119 @@ void Transceiver::driveReceiveFIFO()
 
   mRadioInterface->driveReceiveRadio();
 
-  rxBurst = pullRadioVector(burstTime,RSSI,TOA);
+  if (mNumRxWorkers > 1) dispatchRadioVectors();
+  else {
+    // drain everything the radio delivered, it no longer waits for us
+    while (mReceiveFIFO->size()) {
+      rxBurst = pullRadioVector(burstTime,RSSI,TOA);
+      if (rxBurst) writeRxBurst(*rxBurst,burstTime,RSSI,TOA);
+    }
+  }
 
-  if (rxBurst) { 
+  // Once the radio is past the frame of the waiting bursts, send them,
+  //   rather than wait for a burst of a later frame that may not come.
+  if (mRxBatchCount && (mRadioInterface->getClock()->get().FN() != mRxBatchFN))
+    flushRxBatch();
+}
 
-    LOG(DEBUG) << "burst parameters: "
-	  << " time: " << burstTime
-	  << " RSSI: " << RSSI
-	  << " TOA: "  << TOA
-	  << " bits: " << *rxBurst;
-    
-    char burstString[gSlotLen+10];
-    burstString[0] = burstTime.TN();
-    for (int i = 0; i < 4; i++)
-      burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
-    burstString[5] = RSSI;
-    burstString[6] = (TOA >> 8) & 0x0ff;
-    burstString[7] = TOA & 0x0ff;
-    SoftVector::iterator burstItr = rxBurst->begin();
-
-    for (unsigned int i = 0; i < gSlotLen; i++) {
-      burstString[8+i] =(char) round((*burstItr++)*255.0);
-    }
-    burstString[gSlotLen+9] = '\0';
-    delete rxBurst;
+unsigned Transceiver::rxRecordLen(RxFormat format)
+{
+  switch (format) {
+    case RX_INT8: return 8+gSlotLen;
+    case RX_HARD: return 8+(gSlotLen+7)/8;
+    default: return gSlotLen+10;
+  }
+}
+
+void Transceiver::writeRxBurst(const SoftVector &bits,
+			       const GSM::Time &burstTime,
+			       int RSSI,
+			       int TOA)
+{
+  // bursts are due at the GSM core within a frame of being received
+  int age = slotsBetween(mRadioInterface->getClock()->get(),burstTime);
+  if (age > 8) mRxDeadlines.missed(slotsToMicroseconds(age-8));
+  else mRxDeadlines.met();
+
+  LOG(DEBUG) << "burst parameters: "
+	<< " time: " << burstTime
+	<< " RSSI: " << RSSI
+	<< " TOA: "  << TOA
+	<< " bits: " << bits;
+
+  unsigned batch = mBurstBatch;
+  RxFormat format = mRxFormat[burstTime.TN()];
+
+  // Bursts of a frame go out together, a burst of a new frame pushes out
+  //   whatever is left of the last one.  A packet has a single format.
+  if (mRxBatchCount && ((batch <= 1) || (burstTime.FN() != mRxBatchFN) ||
+                        (format != mRxBatchFormat)))
+    flushRxBatch();
+
+  // Only the original format goes out without a packet header.
+  bool single = (batch <= 1) && (format == RX_BYTES);
+
+  char singleBurst[gSlotLen+10];
+  char *burstString = singleBurst;
+  if (!single) burstString = mRxBatch+1+mRxBatchCount*rxRecordLen(format);
+  burstString[0] = burstTime.TN();
+  for (int i = 0; i < 4; i++)
+    burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
+  burstString[5] = RSSI;
+  burstString[6] = (TOA >> 8) & 0x0ff;
+  burstString[7] = TOA & 0x0ff;
+  SoftVector::const_iterator burstItr = bits.begin();
+
+  switch (format) {
+    case RX_INT8:
+      for (unsigned int i = 0; i < gSlotLen; i++) {
+        float soft = *burstItr++;
+        if (soft < 0.0F) soft = 0.0F;
+        if (soft > 1.0F) soft = 1.0F;
+        burstString[8+i] = (signed char) lrintf((soft-0.5F)*254.0F);
+      }
+      break;
+    case RX_HARD:
+      memset(burstString+8,0,(gSlotLen+7)/8);
+      for (unsigned int i = 0; i < gSlotLen; i++) {
+        if (*burstItr++ > 0.5F) burstString[8+i/8] |= 0x80 >> (i%8);
+      }
+      break;
+    default:
+      for (unsigned int i = 0; i < gSlotLen; i++) {
+        float soft = *burstItr++;
+        if (soft < 0.0F) soft = 0.0F;
+        if (soft > 1.0F) soft = 1.0F;
+        burstString[8+i] =(char) round(soft*255.0);
+      }
+      burstString[gSlotLen+9] = '\0';
+  }
 
-    mDataSocket.write(burstString,gSlotLen+10);
+  if (single) {
+    bool useShm = mUseShm;
+    __sync_synchronize();
+    if (useShm) mDataShm->write(burstString,gSlotLen+10);
+    else mDataSocket.write(burstString,gSlotLen+10);
+    return;
   }
 
+  mRxBatchFN = burstTime.FN();
+  mRxBatchFormat = format;
+  mRxBatchCount++;
+  if ((mRxBatchCount >= batch) || (burstTime.TN() == 7)) flushRxBatch();
+}
+
+void Transceiver::flushRxBatch()
+{
+  if (!mRxBatchCount) return;
+  // the format is in the high nibble of the count, 0 for the original one
+  mRxBatch[0] = (mRxBatchFormat << 4) | mRxBatchCount;
+  unsigned len = 1+mRxBatchCount*rxRecordLen(mRxBatchFormat);
+  bool useShm = mUseShm;
+  __sync_synchronize();
+  if (useShm) mDataShm->write(mRxBatch,len);
+  else mDataSocket.write(mRxBatch,len);
+  mRxBatchCount = 0;
 }
 
 void Transceiver::driveTransmitFIFO() 
@@ -710,31 +1142,22 @@ void Transceiver::driveTransmitFIFO()
   
   if (mOn) {
     //radioClock->wait(); // wait until clock updates
-    LOG(DEBUG) << "radio clock " << radioClock->get();
+    GSM::Time radioTime = radioClock->get();
+    LOG(DEBUG) << "radio clock " << radioTime;
+
+    // the next burst fell due when the radio clock came within the latency
+    //   of it, how far the clock has gone since shows how late we run
+    int pushDelay = slotsBetween(radioTime + mTransmitLatency,mTransmitDeadlineClock);
+    if (pushDelay > 0) mTxPushDelay.add(pushDelay-1);
+
+    updateTransmitLatency(radioTime,mRadioInterface->isUnderrun(mChannel));
+
     while (radioClock->get() + mTransmitLatency > mTransmitDeadlineClock) {
-      // if underrun, then we're not providing bursts to radio/USRP fast
-      //   enough.  Need to increase latency by one GSM frame.
-      if (mRadioInterface->getBus() == RadioDevice::USB) {
-        if (mRadioInterface->isUnderrun()) {
-          // only do latency update every 10 frames, so we don't over update
-          if (radioClock->get() > mLatencyUpdateTime + GSM::Time(10,0)) {
-            mTransmitLatency = mTransmitLatency + GSM::Time(1,0);
-            LOG(INFO) << "new latency: " << mTransmitLatency;
-            mLatencyUpdateTime = radioClock->get();
-          }
-        }
-        else {
-          // if underrun hasn't occurred in the last sec (216 frames) drop
-          //    transmit latency by a timeslot
-          if (mTransmitLatency > GSM::Time(1,1)) {
-              if (radioClock->get() > mLatencyUpdateTime + GSM::Time(216,0)) {
-              mTransmitLatency.decTN();
-              LOG(INFO) << "reduced latency: " << mTransmitLatency;
-              mLatencyUpdateTime = radioClock->get();
-            }
-          }
-        }
-      }
+      // the radio clock follows the received samples, so a burst pushed
+      //   after it has passed is certainly late on the air
+      int late = slotsBetween(radioClock->get(),mTransmitDeadlineClock);
+      if (late > 0) mTxDeadlines.missed(slotsToMicroseconds(late));
+      else mTxDeadlines.met();
       // time to push burst to transmit FIFO
       pushRadioVector(mTransmitDeadlineClock);
       mTransmitDeadlineClock.incTN();
@@ -748,8 +1171,70 @@ void Transceiver::driveTransmitFIFO()
 
 
 
+void Transceiver::updateTransmitLatency(const GSM::Time &radioTime, bool underrun)
+{
+  // if underrun, then we're not providing bursts to radio/USRP fast
+  //   enough.  Need to increase latency by one GSM frame.
+  if (underrun) {
+    mWindowUnderrun = true;
+    mTxStatsLock.lock();
+    mTxUnderruns++;
+    // only do latency update every 10 frames, so we don't over update
+    if (radioTime > mLatencyUpdateTime + GSM::Time(10,0)) {
+      if (mLatencyGuard < TX_TIMING_SLOTS/4) mLatencyGuard += 8;
+      mTransmitLatency = mTransmitLatency + GSM::Time(1,0);
+      LOG(INFO) << "new latency: " << mTransmitLatency;
+      mLatencyUpdateTime = radioTime;
+    }
+    mTxStatsLock.unlock();
+  }
+
+  // about once a second (216 frames) set the latency from the timing
+  //   measured since: cover nearly every push delay plus the guard, but
+  //   let the guard go no further than most bursts from the core allow
+  if (radioTime <= mLatencyWindowStart + GSM::Time(216,0)) return;
+  mLatencyWindowStart = radioTime;
+
+  // if underrun hasn't occurred in the window, shrink the guard by a timeslot
+  if (!mWindowUnderrun && (mLatencyGuard > 1)) mLatencyGuard--;
+  mWindowUnderrun = false;
+
+  int need = 1;
+  if (mTxPushDelay.total()) need += mTxPushDelay.percentile(TX_PUSH_PERCENTILE);
+  mTxPushDelay.clear();
+  int wanted = need - 1 + mLatencyGuard;
+
+  mTxStatsLock.lock();
+  int ceiling = -1;
+  if (mTxArrival.total()) ceiling = mTxArrival.percentile(TX_ARRIVAL_PERCENTILE);
+  mTxArrival.clear();
+  if (ceiling >= 0) {
+    if (ceiling < need)
+      LOG(NOTICE) << "bursts from the GSM core arrive " << ceiling
+                  << " timeslots ahead, but the radio needs " << need;
+    if (wanted > ceiling) wanted = (ceiling > need) ? ceiling : need;
+  }
+  if (wanted < slotsOf(mMinTransmitLatency)) wanted = slotsOf(mMinTransmitLatency);
+
+  // rise at once, but come down a timeslot at a time
+  int latency = slotsOf(mTransmitLatency);
+  if (wanted > latency) latency = wanted;
+  else if (wanted < latency) latency--;
+  if (latency != slotsOf(mTransmitLatency)) {
+    mTransmitLatency = GSM::Time(latency/8,latency%8);
+    LOG(INFO) << "latency now " << mTransmitLatency << ", push delay needs "
+              << need << ", core arrivals allow " << ceiling << ", guard " << mLatencyGuard;
+  }
+  mLatencyFloor = need;
+  mLatencyCeiling = ceiling;
+  mTxStatsLock.unlock();
+}
+
 void Transceiver::writeClockInterface()
 {
+  // the core takes its clock from channel 0 alone
+  if (mChannel) return;
+
   char command[50];
   // FIXME -- This should be adaptive.
   sprintf(command,"IND CLOCK %llu",(unsigned long long) (mTransmitDeadlineClock.FN()+2));
@@ -768,6 +1253,7 @@ void Transceiver::writeClockInterface()
 void *FIFOServiceLoopAdapter(Transceiver *transceiver)
 {
   transceiver->setPriority();
+  transceiver->placeThread("fifo");
 
   while (1) {
     transceiver->driveReceiveFIFO();
@@ -777,8 +1263,22 @@ void *FIFOServiceLoopAdapter(Transceiver *transceiver)
   return NULL;
 }
 
+void *RxWorkerLoopAdapter(RxWorker *worker)
+{
+  worker->trx->setPriority();
+  worker->trx->placeThread("rx",worker->index);
+
+  while (1) {
+    worker->trx->driveRxWorker(worker->index);
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
 void *ControlServiceLoopAdapter(Transceiver *transceiver)
 {
+  transceiver->placeThread("ctrl");
+
   while (1) {
     transceiver->driveControl();
     pthread_testcancel();
@@ -788,6 +1288,8 @@ void *ControlServiceLoopAdapter(Transceiver *transceiver)
 
 void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *transceiver)
 {
+  transceiver->placeThread("txq");
+
   while (1) {
     bool stale = false;
     // Flush the UDP packets until a successful transfer.
@@ -33,24 +33,115 @@
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "Sockets.h"
+#include "ShmSocket.h"
+#include "ThreadProfile.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <string.h>
 
 /** Define this to be the slot number to be logged. */
 //#define TRANSMIT_LOGGING 1
 
+/** Maximum number of received bursts in the demodulator pipeline */
+#define RX_PIPELINE_DEPTH 32
+
+/** Maximum number of demodulator threads, bursts are split among them by timeslot */
+#define MAX_RX_WORKERS 8
+
+/** Maximum number of bursts in one packet on the data interface, one TDMA frame */
+#define MAX_BURST_BATCH 8
+
+/** Number of DFE feedforward taps, the channel estimate may be no longer */
+#define DFE_FORWARD_TAPS 7
+
+/** Normalized LMS step size used to track the DFE filters on each midamble */
+#define DFE_STEP_SIZE 0.1F
+
+/** Midamble mean squared error above which the DFE is designed again from a new channel estimate */
+#define DFE_MAX_TRAINING_ERROR 0.5F
+
+/** Range of the transmit timing histograms in timeslots, longer times are counted in the last bin */
+#define TX_TIMING_SLOTS 256
+
+/** Fraction of bursts pushed to the radio that the transmit latency must cover */
+#define TX_PUSH_PERCENTILE 0.999F
+
+/** Fraction of bursts from the GSM core allowed to arrive later than the transmit latency */
+#define TX_ARRIVAL_PERCENTILE 0.01F
+
+class Transceiver;
+
+/** A histogram of timing samples in whole timeslots, for percentiles over a measurement window */
+class SlotHistogram {
+
+private:
+
+  unsigned mCounts[TX_TIMING_SLOTS];
+  unsigned mTotal;
+
+public:
+
+  SlotHistogram() { clear(); }
+
+  void clear() { memset(mCounts,0,sizeof(mCounts)); mTotal = 0; }
+
+  /** add a sample, clamped to the histogram range */
+  void add(int slots)
+  {
+    if (slots < 0) slots = 0;
+    if (slots >= TX_TIMING_SLOTS) slots = TX_TIMING_SLOTS-1;
+    mCounts[slots]++;
+    mTotal++;
+  }
+
+  unsigned total() const { return mTotal; }
+
+  /** smallest value at or above the given fraction of the samples */
+  int percentile(float fraction) const;
+};
+
+/** Transmit burst accounting of a timeslot */
+struct TxSlotStats {
+  unsigned sent;                       ///< bursts from the GSM core sent on time
+  unsigned late;                       ///< bursts that arrived with less than the transmit latency to spare
+  unsigned dropped;                    ///< bursts discarded because their time had passed
+  unsigned filled;                     ///< timeslots filled from the filler table for lack of a burst
+  TxSlotStats():sent(0),late(0),dropped(0),filled(0) {}
+};
+
+/** A demodulator thread and the timeslots it serves */
+struct RxWorker {
+  Transceiver *trx;                    ///< the owning transceiver
+  int index;                           ///< serves timeslots with TN % number of workers == index
+  Thread thread;
+};
+
 /** The Transceiver class, responsible for physical layer of basestation */
 class Transceiver {
   
 private:
 
   GSM::Time mTransmitLatency;     ///< latency between basestation clock and transmit deadline clock
-  GSM::Time mLatencyUpdateTime;   ///< last time latency was updated
+  GSM::Time mMinTransmitLatency;  ///< lower bound of the transmit latency
+  GSM::Time mLatencyUpdateTime;   ///< last time latency was raised for an underrun
+  GSM::Time mLatencyWindowStart;  ///< start of the current transmit timing window
+  int mLatencyGuard;              ///< timeslots of latency beyond the measured push delay, grows with underruns
+  bool mWindowUnderrun;           ///< the radio underran in the current timing window
+  int mLatencyFloor;              ///< latency needed by the last window's push delays, in timeslots
+  int mLatencyCeiling;            ///< latency allowed by the last window's burst arrivals, in timeslots, -1 if unknown
+
+  Mutex mTxStatsLock;             ///< protects the transmit accounting and mTransmitLatency
+  TxSlotStats mTxStats[8];        ///< transmit burst accounting of all timeslots
+  unsigned mTxUnderruns;          ///< radio underruns reported
+  SlotHistogram mTxArrival;       ///< how far ahead of the radio clock bursts arrived from the GSM core
+  SlotHistogram mTxPushDelay;     ///< how far behind the radio clock the FIFO thread pushed due bursts
 
   UDPSocket mDataSocket;	  ///< socket for writing to/reading from GSM core
   UDPSocket mControlSocket;	  ///< socket for writing/reading control commands from GSM core
   UDPSocket mClockSocket;	  ///< socket for writing clock updates to GSM core
+  ShmSocket *mDataShm;            ///< shared memory data channel, if the GSM core asked for one
+  volatile bool mUseShm;          ///< true once data goes through mDataShm instead of mDataSocket
 
   VectorQueue  mTransmitPriorityQueue;   ///< priority queue of transmit bursts received from GSM core
   VectorFIFO*  mTransmitFIFO;     ///< radioInterface FIFO of transmit bursts 
@@ -64,6 +155,7 @@ private:
   GSM::Time mLastClockUpdateTime;         ///< last time clock update was sent up to core
 
   RadioInterface *mRadioInterface;	  ///< associated radioInterface object
+  int mChannel;                           ///< channel of mRadioInterface served by this transceiver
   double txFullScale;                     ///< full scale input to radio
   double rxFullScale;                     ///< full scale output to radio
 
@@ -76,6 +168,34 @@ private:
   } CorrType;
 
 
+  /** States of a received burst in the demodulator pipeline */
+  typedef enum {
+    RX_FREE,           ///< pipeline slot is unused
+    RX_PENDING,        ///< burst is waiting for its worker
+    RX_BUSY,           ///< burst is being demodulated
+    RX_DONE            ///< result is waiting to be sent in time order
+  } RxJobState;
+
+  /** A received burst and its demodulation result */
+  struct RxJob {
+    RxJobState state;
+    radioVector *burst;                ///< received samples, owned until demodulated
+    CorrType corrType;                 ///< expected burst type
+    GSM::Time time;                    ///< timestamp of the burst
+    bool valid;                        ///< true if the burst was detected and demodulated
+    int RSSI;
+    int timingOffset;
+    SoftVector bits;                   ///< demodulated bits
+    RxJob():state(RX_FREE),burst(NULL),bits(gSlotLen) {}
+  };
+
+  /** Soft bit formats of received bursts on the data interface */
+  typedef enum {
+    RX_BYTES,          ///< one byte per bit, 0 for a certain "0" to 255 for a certain "1"
+    RX_INT8,           ///< one signed byte per bit, -127 for a certain "0" to 127 for a certain "1"
+    RX_HARD            ///< hard decisions, 8 bits per byte, first bit in the MSB
+  } RxFormat;
+
   /** Codes for channel combinations */
   typedef enum {
     FILL,               ///< Channel is transmitted, but unused
@@ -104,10 +224,45 @@ private:
   /** Push modulated burst into transmit FIFO corresponding to a particular timestamp */
   void pushRadioVector(GSM::Time &nowTime);
 
-  /** Pull and demodulate a burst from the receive FIFO */ 
+  /**
+    Pull and demodulate a burst from the receive FIFO
+    @return The demodulated bits, owned by the Transceiver and valid until the next call, or NULL
+  */
   SoftVector *pullRadioVector(GSM::Time &wTime,
 			   int &RSSI,
 			   int &timingOffset);
+
+  /**
+    Detect and demodulate a received burst.
+    Safe to run concurrently for bursts of different timeslots.
+    @param rxBurst The received burst, modified in place
+    @param corrType The expected burst type, neither OFF nor IDLE
+    @param bits The demodulated bits
+    @return true if a burst was detected and demodulated
+  */
+  bool demodulateRadioVector(radioVector &rxBurst,
+			     CorrType corrType,
+			     SoftVector &bits,
+			     int &RSSI,
+			     int &timingOffset);
+
+  /** Hand all bursts in the receive FIFO to the demodulator workers */
+  void dispatchRadioVectors();
+
+  /** Send finished bursts at the head of the demodulator pipeline, in time order */
+  void writeRxJobs();
+
+  /** Length of a received burst record in a given format */
+  static unsigned rxRecordLen(RxFormat format);
+
+  /** Send the batched received bursts to the GSM core */
+  void flushRxBatch();
+
+  /** Send a demodulated burst to the GSM core, batched if the core asked for it */
+  void writeRxBurst(const SoftVector &bits,
+		    const GSM::Time &burstTime,
+		    int RSSI,
+		    int timingOffset);
    
   /** Set modulus for specific timeslot */
   void setModulus(int timeslot);
@@ -115,9 +270,15 @@ private:
   /** return the expected burst type for the specified timestamp */
   CorrType expectedCorrType(GSM::Time currTime);
 
+  /** adapt the transmit latency to the push delays, burst arrivals and underruns measured so far */
+  void updateTransmitLatency(const GSM::Time &radioTime, bool underrun);
+
   /** send messages over the clock socket */
   void writeClockInterface(void);
 
+  /** generate the midamble of a TSC, or the RACH sequence for a negative TSC, unless another channel did */
+  void generateSequences(int TSC);
+
   signalVector *gsmPulse;              ///< the GSM shaping pulse for modulation
 
   int mSamplesPerSymbol;               ///< number of samples per GSM symbol
@@ -131,17 +292,42 @@ private:
   double mEnergyThreshold;             ///< threshold to determine if received data is potentially a GSM burst
   GSM::Time prevFalseDetectionTime;    ///< last timestamp of a false energy detection
   int fillerModulus[8];                ///< modulus values of all timeslots, in frames
-  signalVector *fillerTable[102][8];   ///< table of modulated filler waveforms for all timeslots
+  sharedVector *fillerTable[102][8];   ///< table of modulated filler waveforms for all timeslots
+  VectorCache  mBurstCache;            ///< previously modulated bursts, keyed by content
   unsigned mMaxExpectedDelay;            ///< maximum expected time-of-arrival offset in GSM symbols
 
   GSM::Time    channelEstimateTime[8]; ///< last timestamp of each timeslot's channel estimate
-  signalVector *channelResponse[8];    ///< most recent channel estimate of all timeslots
   float        SNRestimate[8];         ///< most recent SNR estimate of all timeslots
-  signalVector *DFEForward[8];         ///< most recent DFE feedforward filter of all timeslots
-  signalVector *DFEFeedback[8];        ///< most recent DFE feedback filter of all timeslots
+  bool         DFEValid[8];            ///< true while a timeslot's DFE filters are designed and tracking
+  complex      DFEForward[8][DFE_FORWARD_TAPS];     ///< DFE feedforward filter of all timeslots
+  complex      DFEFeedback[8][DFE_FORWARD_TAPS-1];  ///< DFE feedback filter of all timeslots
+  int          DFEFeedbackLen[8];      ///< number of DFE feedback taps in use in each timeslot
   float        chanRespOffset[8];      ///< most recent timing offset, e.g. TOA, of all timeslots
   complex      chanRespAmplitude[8];   ///< most recent channel amplitude of all timeslots
 
+  SoftVector   mRxBurstBits;           ///< preallocated demodulator output, reused for every burst
+  BitVector    mTxBurstBits;           ///< preallocated bits of the burst being queued for transmission
+
+  unsigned     mBurstBatch;            ///< received bursts per data packet, 1 for the one-burst protocol
+  unsigned     mRxBatchCount;          ///< received bursts waiting in mRxBatch
+  int          mRxBatchFN;             ///< frame number of the waiting bursts
+  RxFormat     mRxBatchFormat;         ///< soft bit format of the waiting bursts
+  RxFormat     mRxFormat[8];           ///< soft bit format of received bursts of all timeslots
+  char         mRxBatch[1+MAX_BURST_BATCH*(gSlotLen+10)]; ///< batched receive packet being assembled
+
+  Mutex        mRxStateLock;           ///< protects the detection state shared by all timeslots
+
+  int          mNumRxWorkers;          ///< number of demodulator threads, 1 to demodulate in the FIFO thread
+  RxWorker     mRxWorkers[MAX_RX_WORKERS]; ///< demodulator threads
+  RxJob        mRxJobs[RX_PIPELINE_DEPTH]; ///< bursts in flight, a ring in time order
+  unsigned     mRxHead;                ///< oldest burst in the pipeline
+  unsigned     mRxTail;                ///< next free pipeline slot
+  Mutex        mRxLock;                ///< protects the pipeline slot states
+  Signal       mRxSignal;              ///< signals a change of a pipeline slot state
+
+  DeadlineMonitor mTxDeadlines;        ///< bursts pushed to the radio after their timeslot began
+  DeadlineMonitor mRxDeadlines;        ///< bursts sent to the GSM core more than a frame after they were received
+
 public:
 
   /** Transceiver constructor 
@@ -150,12 +336,18 @@ public:
       @param wSamplesPerSymbol number of samples per GSM symbol
       @param wTransmitLatency initial setting of transmit latency
       @param radioInterface associated radioInterface object
+      @param wRxWorkers number of demodulator threads, 1 to demodulate in the FIFO thread
+      @param wChannel ARFCN of a multi-channel radioInterface, channel 0 owns the clock
+      @param wStartFN frame number to start the clock at, random if negative
   */
   Transceiver(int wBasePort,
 	      const char *TRXAddress,
 	      int wSamplesPerSymbol,
 	      GSM::Time wTransmitLatency,
-	      RadioInterface *wRadioInterface);
+	      RadioInterface *wRadioInterface,
+	      int wRxWorkers = 1,
+	      int wChannel = 0,
+	      int wStartFN = -1);
    
   /** Destructor */
   ~Transceiver();
@@ -180,6 +372,9 @@ protected:
   /** drive handling of control messages from GSM core */
   void driveControl();
 
+  /** demodulate the next burst queued for a worker */
+  void driveRxWorker(int index);
+
   /**
     drive modulation and sorting of GSM bursts from GSM core
     @return true if a burst was transferred successfully
@@ -192,11 +387,16 @@ protected:
 
   friend void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+  friend void *RxWorkerLoopAdapter(RxWorker *);
+
   void reset();
 
   /** set priority on current thread */
   void setPriority() { mRadioInterface->setPriority(); }
 
+  /** name the current thread and give it the placement of its role in gThreadProfile */
+  void placeThread(const char *role, int index = -1) { gThreadProfile.apply(role,mChannel,index); }
+
 };
 
 /** FIFO thread loop */
@@ -208,3 +408,6 @@ void *ControlServiceLoopAdapter(Transceiver *);
 /** transmit queueing thread loop */
 void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+/** demodulator worker thread loop */
+void *RxWorkerLoopAdapter(RxWorker *);
+
@@ -21,6 +21,7 @@
 
 #include "radioDevice.h"
 #include "Threads.h"
+#include "ThreadProfile.h"
 #include "Logger.h"
 #include <uhd/version.hpp>
 #include <uhd/property_tree.hpp>
@@ -240,6 +241,8 @@ private:
 
 void *async_event_loop(uhd_device *dev)
 {
+	gThreadProfile.apply("async");
+
 	while (1) {
 		dev->recv_async_msg();
 		pthread_testcancel();
@@ -0,0 +1,222 @@
+/*
+ * SIMD dot product kernels for convolution and correlation
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include "convolve.h"
+
+/*
+ * Vector kernels are built with per-function target attributes so the
+ * rest of the library keeps the baseline instruction set. Selection
+ * happens at runtime, so one binary runs on any x86 host.
+ */
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+  #define HAVE_X86_KERNELS 1
+  #include <immintrin.h>
+#endif
+
+/* Scalar complex-complex dot product */
+static void base_dot_complex(const float *x, const float *h,
+			     int len, float *out)
+{
+	int i;
+	float re = 0.0f, im = 0.0f;
+
+	for (i = 0; i < len; i++) {
+		re += x[2 * i + 0] * h[2 * i + 0] - x[2 * i + 1] * h[2 * i + 1];
+		im += x[2 * i + 0] * h[2 * i + 1] + x[2 * i + 1] * h[2 * i + 0];
+	}
+
+	out[0] = re;
+	out[1] = im;
+}
+
+/* Scalar complex-real dot product */
+static void base_dot_real(const float *x, const float *h,
+			  int len, float *out)
+{
+	int i;
+	float re = 0.0f, im = 0.0f;
+
+	for (i = 0; i < len; i++) {
+		re += x[2 * i + 0] * h[2 * i + 0];
+		im += x[2 * i + 1] * h[2 * i + 0];
+	}
+
+	out[0] = re;
+	out[1] = im;
+}
+
+const struct convolve_kernels convolve_base = {
+	"scalar",
+	base_dot_complex,
+	base_dot_real,
+};
+
+#ifdef HAVE_X86_KERNELS
+/*
+ * SSE3 kernels, two complex samples per iteration
+ *
+ * Products of the real and imaginary parts of the taps are accumulated
+ * separately and combined with a single add-subtract at the end.
+ */
+__attribute__((target("sse3")))
+static void sse3_dot_complex(const float *x, const float *h,
+			     int len, float *out)
+{
+	int i;
+	float tail[2];
+	__m128 a, b, acc_re, acc_im, sum;
+
+	acc_re = _mm_setzero_ps();
+	acc_im = _mm_setzero_ps();
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		a = _mm_loadu_ps(&x[2 * i]);
+		b = _mm_loadu_ps(&h[2 * i]);
+		acc_re = _mm_add_ps(acc_re, _mm_mul_ps(a, _mm_moveldup_ps(b)));
+		a = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+		acc_im = _mm_add_ps(acc_im, _mm_mul_ps(a, _mm_movehdup_ps(b)));
+	}
+
+	sum = _mm_addsub_ps(acc_re, acc_im);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+
+	base_dot_complex(&x[2 * i], &h[2 * i], len - i, tail);
+	out[0] = _mm_cvtss_f32(sum) + tail[0];
+	out[1] = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1)) + tail[1];
+}
+
+__attribute__((target("sse3")))
+static void sse3_dot_real(const float *x, const float *h,
+			  int len, float *out)
+{
+	int i;
+	float tail[2];
+	__m128 acc, sum;
+
+	acc = _mm_setzero_ps();
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&x[2 * i]),
+				 _mm_moveldup_ps(_mm_loadu_ps(&h[2 * i]))));
+	}
+
+	sum = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+
+	base_dot_real(&x[2 * i], &h[2 * i], len - i, tail);
+	out[0] = _mm_cvtss_f32(sum) + tail[0];
+	out[1] = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1)) + tail[1];
+}
+
+/*
+ * AVX2/FMA kernels, four complex samples per iteration
+ *
+ * The upper register halves are cleared before the SSE3 tail and the
+ * return. Legacy SSE code that runs with dirty upper halves stalls on
+ * every instruction, which makes short dot products far slower than
+ * the scalar ones.
+ */
+__attribute__((target("avx2,fma")))
+static void avx2_dot_complex(const float *x, const float *h,
+			     int len, float *out)
+{
+	int i;
+	float tail[2];
+	__m256 a, b, acc_re, acc_im, sum;
+	__m128 half;
+
+	acc_re = _mm256_setzero_ps();
+	acc_im = _mm256_setzero_ps();
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		a = _mm256_loadu_ps(&x[2 * i]);
+		b = _mm256_loadu_ps(&h[2 * i]);
+		acc_re = _mm256_fmadd_ps(a, _mm256_moveldup_ps(b), acc_re);
+		a = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+		acc_im = _mm256_fmadd_ps(a, _mm256_movehdup_ps(b), acc_im);
+	}
+
+	sum = _mm256_addsub_ps(acc_re, acc_im);
+	half = _mm_add_ps(_mm256_castps256_ps128(sum),
+			  _mm256_extractf128_ps(sum, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	_mm256_zeroupper();
+
+	sse3_dot_complex(&x[2 * i], &h[2 * i], len - i, tail);
+	out[0] = _mm_cvtss_f32(half) + tail[0];
+	out[1] = _mm_cvtss_f32(_mm_shuffle_ps(half, half, 1)) + tail[1];
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_dot_real(const float *x, const float *h,
+			  int len, float *out)
+{
+	int i;
+	float tail[2];
+	__m256 acc;
+	__m128 half;
+
+	acc = _mm256_setzero_ps();
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		acc = _mm256_fmadd_ps(_mm256_loadu_ps(&x[2 * i]),
+			_mm256_moveldup_ps(_mm256_loadu_ps(&h[2 * i])), acc);
+	}
+
+	half = _mm_add_ps(_mm256_castps256_ps128(acc),
+			  _mm256_extractf128_ps(acc, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	_mm256_zeroupper();
+
+	sse3_dot_real(&x[2 * i], &h[2 * i], len - i, tail);
+	out[0] = _mm_cvtss_f32(half) + tail[0];
+	out[1] = _mm_cvtss_f32(_mm_shuffle_ps(half, half, 1)) + tail[1];
+}
+
+static const struct convolve_kernels convolve_sse3 = {
+	"sse3",
+	sse3_dot_complex,
+	sse3_dot_real,
+};
+
+static const struct convolve_kernels convolve_avx2 = {
+	"avx2",
+	avx2_dot_complex,
+	avx2_dot_real,
+};
+#endif /* HAVE_X86_KERNELS */
+
+const struct convolve_kernels *convolve_impl = &convolve_base;
+
+const struct convolve_kernels *convolve_init(void)
+{
+	convolve_impl = &convolve_base;
+
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		convolve_impl = &convolve_avx2;
+	else if (__builtin_cpu_supports("sse3"))
+		convolve_impl = &convolve_sse3;
+#endif
+
+	return convolve_impl;
+}
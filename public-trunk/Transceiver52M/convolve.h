@@ -0,0 +1,47 @@
+/*
+ * SIMD dot product kernels for convolution and correlation
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+/*
+ * All vectors are interleaved complex float arrays (re, im, re, im, ...).
+ * Each kernel accumulates sum(x[k] * h[k]) for k < len and writes the
+ * complex result to out[0] (real) and out[1] (imaginary).
+ *
+ * dot_complex - x and h are both complex
+ * dot_real    - x is complex, only the real parts of h are used
+ */
+struct convolve_kernels {
+	const char *name;
+	void (*dot_complex)(const float *x, const float *h, int len, float *out);
+	void (*dot_real)(const float *x, const float *h, int len, float *out);
+};
+
+/* Portable scalar kernels, always available */
+extern const struct convolve_kernels convolve_base;
+
+/* Kernels selected by convolve_init() for the running CPU */
+extern const struct convolve_kernels *convolve_impl;
+
+/* Detect CPU features and select the fastest available kernels */
+const struct convolve_kernels *convolve_init(void);
+
+#endif /* CONVOLVE_H */
@@ -39,19 +39,6 @@ static int float_to_short(short *shrt_out, float *flt_in, int num)
 	return i;
 }
 
-/* Comlpex short to float conversion */
-static int short_to_float(float *flt_out, short *shrt_in, int num)
-{
-	int i;
-
-	for (i = 0; i < num; i++) {
-		flt_out[2 * i + 0] = shrt_in[2 * i + 0];
-		flt_out[2 * i + 1] = shrt_in[2 * i + 1];
-	}
-
-	return i;
-}
-
 /* Receive a timestamped chunk from the device */ 
 void RadioInterface::pullBuffer()
 {
@@ -64,11 +51,16 @@ void RadioInterface::pullBuffer()
 	LOG(DEBUG) << "Rx read " << num_rd << " samples from device";
 	assert(num_rd == OUTCHUNK);
 
+	if (mCapture)
+		mCapture->write(rx_buf, num_rd, readTimestamp, overrun,
+				 mClock.get());
+
 	underrun |= local_underrun;
 	readTimestamp += (TIMESTAMP) num_rd;
 
-	short_to_float(rcvBuffer + 2 * rcvCursor, rx_buf, num_rd);
-	rcvCursor += num_rd;
+	/* Convert straight into the receive bursts */
+	const short *bufs[] = { rx_buf };
+	receiveSamples(bufs, mChanActive, num_rd);
 }
 
 /* Send timestamped chunk to the device with arbitrary size */ 
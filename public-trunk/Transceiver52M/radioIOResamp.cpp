@@ -20,6 +20,7 @@
  */
 
 #include <radioInterface.h>
+#include <Resampler.h>
 #include <Logger.h>
 
 /* New chunk sizes for resampled rate */
@@ -32,243 +33,58 @@
 
 /* Resampling parameters */
 #define INRATE       65 * SAMPSPERSYM
-#define INHISTORY    INRATE * 2
 #define INCHUNK      INRATE * 9
 
 #define OUTRATE      96 * SAMPSPERSYM
-#define OUTHISTORY   OUTRATE * 2
 #define OUTCHUNK     OUTRATE * 9
 
-/* Resampler low pass filters */
-signalVector *tx_lpf = 0;
-signalVector *rx_lpf = 0;
-
-/* Resampler history */
-signalVector *tx_hist = 0;
-signalVector *rx_hist = 0;
-
-/* Resampler input buffer */
-signalVector *tx_vec = 0;
-signalVector *rx_vec = 0;
+/* Stream resamplers, created on first use */
+static Resampler *tx_resampler = NULL;
+static Resampler *rx_resampler = NULL;
 
 /*
  * High rate (device facing) buffers
  *
- * Transmit side samples are pushed after each burst so accomodate
- * a resampled burst plus up to a chunk left over from the previous
- * resampling operation.
+ * Transmit side samples are pushed once a chunk has accumulated, so
+ * accomodate a resampled chunk plus the burst that completed it.
  *
  * Receive side samples always pulled with a fixed size.
  */
-short tx_buf[INCHUNK * 2 * 4];
-short rx_buf[OUTCHUNK * 2 * 2];
-
-/* 
- * Utilities and Conversions 
- *
- * Manipulate signal vectors dynamically for two reasons. For one,
- * it's simpler. And two, it doesn't make any reasonable difference
- * relative to the high overhead generated by the resampling.
- */
-
-/* Concatenate signal vectors. Deallocate input vectors. */
-signalVector *concat(signalVector *a, signalVector *b)
-{
-	signalVector *vec = new signalVector(*a, *b);
-	delete a;
-	delete b;
-
-	return vec;
-}
-
-/* Segment a signal vector. Deallocate the input vector. */
-signalVector *segment(signalVector *a, int indx, int sz)
-{
-	signalVector *vec = new signalVector(sz);
-	a->segmentCopyTo(*vec, indx, sz);
-	delete a;
-
-	return vec;
-}
-
-/* Create a new signal vector from a short array. */
-signalVector *short_to_sigvec(short *smpls, size_t sz)
-{
-	int i;
-	signalVector *vec = new signalVector(sz);
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < sz; i++) {
-		*itr++ = Complex<float>(smpls[2 * i + 0], smpls[2 * i + 1]);
-	}
-
-	return vec;
-}
-
-/* Convert and deallocate a signal vector into a short array. */
-int sigvec_to_short(signalVector *vec, short *smpls)
-{
-	int i;
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < vec->size(); i++) {
-		smpls[2 * i + 0] = itr->real();
-		smpls[2 * i + 1] = itr->imag();
-		itr++;
-	}
-	delete vec;
-
-	return i;
-}
-
-/* Create a new signal vector from a float array. */
-signalVector *float_to_sigvec(float *smpls, int sz)
-{
-	int i;
-	signalVector *vec = new signalVector(sz);
-	signalVector::iterator itr = vec->begin();
-
-	for (i = 0; i < sz; i++) {
-		*itr++ = Complex<float>(smpls[2 * i + 0], smpls[2 * i + 1]);
-	}
-
-	return vec;
-}
-
-/* Convert and deallocate a signal vector into a float array. */
-int sigvec_to_float(signalVector *vec, float *smpls)
-{
-	int i;
-	signalVector::iterator itr = vec->begin();
+#define TX_BUF_LEN   INCHUNK * 4
+#define RX_BUF_LEN   OUTCHUNK * 2
 
-	for (i = 0; i < vec->size(); i++) {
-		smpls[2 * i + 0] = itr->real();
-		smpls[2 * i + 1] = itr->imag();
-		itr++;
-	}
-	delete vec;
-
-	return i;
-}
+short tx_buf[TX_BUF_LEN * 2];
+short rx_buf[RX_BUF_LEN * 2];
 
-/* Initialize resampling signal vectors */
-void init_resampler(signalVector **lpf,
-	   	    signalVector **buf,
-		    signalVector **hist,
-		    int tx)
+/* Create a resampler with the receive or transmit low pass filter */
+static Resampler *init_resampler(int tx)
 {
-	int P, Q, taps, hist_len;
+	int P, Q, taps, chunk;
 	float cutoff_freq;
+	signalVector *lpf;
+	Resampler *resampler;
 
 	if (tx) {
 		LOG(INFO) << "Initializing Tx resampler";
 		P = OUTRATE;
 		Q = INRATE;
 		taps = 651;
-		hist_len = INHISTORY;
+		chunk = INCHUNK * 2;
 	} else {
 		LOG(INFO) << "Initializing Rx resampler";
 		P = INRATE;
 		Q = OUTRATE;
 		taps = 961;
-		hist_len = OUTHISTORY;
+		chunk = OUTCHUNK;
 	}
 
-	if (!*lpf) {
-		cutoff_freq = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
-		*lpf = createLPF(cutoff_freq, taps, P);
-	}
+	cutoff_freq = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
+	lpf = createLPF(cutoff_freq, taps, P);
 
-	if (!*buf) {
-		*buf = new signalVector();
-	}
+	resampler = new Resampler(P, Q, *lpf, chunk);
+	delete lpf;
 
-	if (!*hist);
-		*hist = new signalVector(hist_len);
-}
-
-/* Resample a signal vector
- *
- * The input vector is deallocated and the pointer returned with a vector
- * of any unconverted samples.
- */
-signalVector *resmpl_sigvec(signalVector *hist, signalVector **vec,
-			    signalVector *lpf, double in_rate,
-			    double out_rate, int chunk_sz)
-{
-	signalVector *resamp_vec;
-	int num_chunks = (*vec)->size() / chunk_sz;
-
-	/* Truncate to a chunk multiple */
-	signalVector trunc_vec(num_chunks * chunk_sz);
-	(*vec)->segmentCopyTo(trunc_vec, 0, num_chunks * chunk_sz);
-
-	/* Update sample buffer with remainder */
-	*vec = segment(*vec, trunc_vec.size(), (*vec)->size() - trunc_vec.size());
-
-	/* Add history and resample */
-	signalVector input_vec(*hist, trunc_vec);
-	resamp_vec = polyphaseResampleVector(input_vec, in_rate,
-					     out_rate, lpf);
-
-	/* Update history */
-	trunc_vec.segmentCopyTo(*hist, trunc_vec.size() - hist->size(),
-				hist->size());
-	return resamp_vec;
-}
-
-/* Wrapper for receive-side integer-to-float array resampling */
- int rx_resmpl_int_flt(float *smpls_out, short *smpls_in, int num_smpls)
-{
-	int num_resmpld, num_chunks;
-	signalVector *convert_vec, *resamp_vec, *trunc_vec;
-
-	if (!rx_lpf || !rx_vec || !rx_hist)
-		init_resampler(&rx_lpf, &rx_vec, &rx_hist, false);
-
-	/* Convert and add samples to the receive buffer */
-	convert_vec = short_to_sigvec(smpls_in, num_smpls);
-	rx_vec = concat(rx_vec, convert_vec);
-
-	num_chunks = rx_vec->size() / OUTCHUNK;
-	if (num_chunks < 1)
-		return 0;
-
-	/* Resample */ 
-	resamp_vec = resmpl_sigvec(rx_hist, &rx_vec, rx_lpf,
-				   INRATE, OUTRATE, OUTCHUNK);
-	/* Truncate */
-	trunc_vec = segment(resamp_vec, INHISTORY,
-                            resamp_vec->size() - INHISTORY);
-	/* Convert */
-	num_resmpld = sigvec_to_float(trunc_vec, smpls_out);
-
-	return num_resmpld; 
-}
-
-/* Wrapper for transmit-side float-to-int array resampling */
-int tx_resmpl_flt_int(short *smpls_out, float *smpls_in, int num_smpls)
-{
-	int num_resmpl, num_chunks;
-	signalVector *convert_vec, *resamp_vec;
-
-	if (!tx_lpf || !tx_vec || !tx_hist)
-		init_resampler(&tx_lpf, &tx_vec, &tx_hist, true);
-
-	/* Convert and add samples to the transmit buffer */
-	convert_vec = float_to_sigvec(smpls_in, num_smpls);
-	tx_vec = concat(tx_vec, convert_vec);
-
-	num_chunks = tx_vec->size() / INCHUNK;
-	if (num_chunks < 1)
-		return 0;
-
-	/* Resample and convert to an integer array */
-	resamp_vec = resmpl_sigvec(tx_hist, &tx_vec, tx_lpf,
-				   OUTRATE, INRATE, INCHUNK);
-	num_resmpl = sigvec_to_short(resamp_vec, smpls_out);
-
-	return num_resmpl; 
+	return resampler;
 }
 
 /* Receive a timestamped chunk from the device */ 
@@ -277,6 +93,9 @@ void RadioInterface::pullBuffer()
 	int num_cv, num_rd;
 	bool local_underrun;
 
+	if (!rx_resampler)
+		rx_resampler = init_resampler(false);
+
 	/* Read samples. Fail if we don't get what we want. */
 	num_rd = mRadio->readSamples(rx_buf, OUTCHUNK, &overrun,
 				     readTimestamp, &local_underrun);
@@ -284,16 +103,20 @@ void RadioInterface::pullBuffer()
 	LOG(DEEPDEBUG) << "Rx read " << num_rd << " samples from device";
 	assert(num_rd == OUTCHUNK);
 
+	if (mCapture)
+		mCapture->write(rx_buf, num_rd, readTimestamp, overrun,
+				 mClock.get());
+
 	underrun |= local_underrun;
 	readTimestamp += (TIMESTAMP) num_rd;
 
-	/* Convert and resample */
-	num_cv = rx_resmpl_int_flt(rcvBuffer + 2 * rcvCursor,
-				   rx_buf, num_rd);
+	/* Convert and resample, then split into the receive bursts */
+	num_cv = rx_resampler->rotate(rx_buf, num_rd, rcvBuffer, INCHUNK);
 
 	LOG(DEEPDEBUG) << "Rx read " << num_cv << " samples from resampler";
 
-	rcvCursor += num_cv;
+	const float *bufs[] = { rcvBuffer };
+	receiveSamples(bufs, mChanActive, num_cv);
 }
 
 /* Send a timestamped chunk to the device */ 
@@ -304,20 +127,22 @@ void RadioInterface::pushBuffer()
 	if (sendCursor < INCHUNK)
 		return;
 
+	if (!tx_resampler)
+		tx_resampler = init_resampler(true);
+
 	LOG(DEEPDEBUG) << "Tx wrote " << sendCursor << " samples to resampler";
 
 	/* Resample and convert */
-	num_cv = tx_resmpl_flt_int(tx_buf, sendBuffer, sendCursor);
-	assert(num_cv > sendCursor);
+	num_cv = tx_resampler->rotate(sendBuffer, sendCursor,
+				      tx_buf, TX_BUF_LEN);
 
 	/* Write samples. Fail if we don't get what we want. */
-	num_wr = mRadio->writeSamples(tx_buf + OUTHISTORY * 2,
-				      num_cv - OUTHISTORY,
+	num_wr = mRadio->writeSamples(tx_buf, num_cv,
 				      &underrun,
 				      writeTimestamp);
 
 	LOG(DEEPDEBUG) << "Tx wrote " << num_wr << " samples to device";
-	assert(num_wr == num_wr);
+	assert(num_wr == num_cv);
 
 	writeTimestamp += (TIMESTAMP) num_wr;
 	sendCursor = 0;
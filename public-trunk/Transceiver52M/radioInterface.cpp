@@ -23,6 +23,7 @@
 */
 
 #include "radioInterface.h"
+#include "ThreadProfile.h"
 #include <Logger.h>
 
 bool started = false;
@@ -32,16 +33,25 @@ RadioInterface::RadioInterface(RadioDevice *wRadio,
 			       int wRadioOversampling,
 			       int wTransceiverOversampling,
 			       GSM::Time wStartTime)
-  : underrun(false), sendCursor(0), rcvCursor(0), mOn(false),
+  : mChans(1), underrun(false), sendCursor(0), rcvBuffer(NULL), mRxPool(NULL),
+    rcvBurstLen(0), rcvBurstFill(0), mOn(false), mCapture(NULL),
     mRadio(wRadio), receiveOffset(wReceiveOffset),
     samplesPerSymbol(wRadioOversampling), powerScaling(1.0)
 {
+  for (int i = 0; i < MAX_RADIO_CHANS; i++) {
+    mChanActive[i] = false;
+    rcvBurst[i] = NULL;
+    rcvBurstActive[i] = false;
+  }
   mClock.set(wStartTime);
 }
 
 
 RadioInterface::~RadioInterface(void) {
   if (rcvBuffer!=NULL) delete rcvBuffer;
+  for (int i = 0; i < mChans; i++)
+    if (rcvBurst[i]) mRxPool->put(rcvBurst[i]);
+  delete mRxPool;
   //mReceiveFIFO.clear();
 }
 
@@ -53,7 +63,7 @@ double RadioInterface::fullScaleOutputValue(void) {
   return mRadio->fullScaleOutputValue();
 }
 
-void RadioInterface::setPowerAttenuation(double atten)
+void RadioInterface::setPowerAttenuation(double atten, int chan)
 {
   double rfGain, digAtten;
 
@@ -88,32 +98,30 @@ int RadioInterface::radioifyVector(signalVector &wVector,
   return wVector.size();
 }
 
-int RadioInterface::unRadioifyVector(float *floatVector,
-				     signalVector& newVector)
-{
-  int i;
-  signalVector::iterator itr = newVector.begin();
-
-  for (i = 0; i < newVector.size(); i++) {
-    *itr++ = Complex<float>(floatVector[2 * i + 0],
-			    floatVector[2 * i + 1]);
-  }
-
-  return newVector.size();
-}
-
-bool RadioInterface::tuneTx(double freq)
+bool RadioInterface::tuneTx(double freq, int chan)
 {
   return mRadio->setTxFreq(freq);
 }
 
-bool RadioInterface::tuneRx(double freq)
+bool RadioInterface::tuneRx(double freq, int chan)
 {
   return mRadio->setRxFreq(freq);
 }
 
 
-void RadioInterface::start()
+void RadioInterface::start(int chan)
+{
+  startRadio();
+
+  sendBuffer = new float[2*2*INCHUNK*samplesPerSymbol];
+  rcvBuffer = new float[2*2*OUTCHUNK*samplesPerSymbol];
+  mRxPool = new BurstPool(RX_POOL_SIZE,(gSlotLen+9)*samplesPerSymbol);
+ 
+  mChanActive[0] = true;
+  mOn = true;
+}
+
+void RadioInterface::startRadio()
 {
   LOG(INFO) << "starting radio interface...";
   mAlignRadioServiceLoopThread.start((void * (*)(void*))AlignRadioServiceLoopAdapter,
@@ -124,15 +132,12 @@ void RadioInterface::start()
   LOG(DEBUG) << "Radio started";
   mRadio->updateAlignment(writeTimestamp-10000); 
   mRadio->updateAlignment(writeTimestamp-10000);
-
-  sendBuffer = new float[2*2*INCHUNK*samplesPerSymbol];
-  rcvBuffer = new float[2*2*OUTCHUNK*samplesPerSymbol];
- 
-  mOn = true;
 }
 
 void *AlignRadioServiceLoopAdapter(RadioInterface *radioInterface)
 {
+  gThreadProfile.apply("align");
+
   while (1) {
     radioInterface->alignRadio();
     pthread_testcancel();
@@ -145,7 +150,7 @@ void RadioInterface::alignRadio() {
   mRadio->updateAlignment(writeTimestamp+ (TIMESTAMP) 10000);
 }
 
-void RadioInterface::driveTransmitRadio(signalVector &radioBurst, bool zeroBurst) {
+void RadioInterface::driveTransmitRadio(signalVector &radioBurst, bool zeroBurst, int chan) {
 
   if (!mOn) return;
 
@@ -160,46 +165,78 @@ void RadioInterface::driveReceiveRadio() {
 
   if (!mOn) return;
 
-  if (mReceiveFIFO.size() > 8) return;
-
+  // keep reading even when the transceiver falls behind, so that the
+  //   clock and the transmit side never wait on the demodulator
   pullBuffer();
+}
 
-  GSM::Time rcvClock = mClock.get();
-  rcvClock.decTN(receiveOffset);
-  unsigned tN = rcvClock.TN();
-  int rcvSz = rcvCursor;
-  int readSz = 0;
+// Received samples are converted straight into pool buffers, one burst
+//   each, which the bursts passed up to the Transceiver then alias.
+// All channels share the clock, so their bursts start and end together.
+// Using the 157-156-156-156 symbols per timeslot format.
+template <typename T>
+void RadioInterface::receiveSamples(const T *const *samples, const bool *active, int num)
+{
   const int symbolsPerSlot = gSlotLen + 8;
-
-  // while there's enough data in receive buffer, form received 
-  //    GSM bursts and pass up to Transceiver
-  // Using the 157-156-156-156 symbols per timeslot format.
-  while (rcvSz > (symbolsPerSlot + (tN % 4 == 0))*samplesPerSymbol) {
-    signalVector rxVector((symbolsPerSlot + (tN % 4 == 0)*samplesPerSymbol));
-    unRadioifyVector(rcvBuffer+readSz*2,rxVector);
-    GSM::Time tmpTime = rcvClock;
-    if (rcvClock.FN() >= 0) {
-      LOG(DEEPDEBUG) << "FN: " << rcvClock.FN();
-      radioVector* rxBurst = new radioVector(rxVector,tmpTime);
-      mReceiveFIFO.put(rxBurst); 
+  int offset = 0;
+
+  while (num > 0) {
+    GSM::Time rcvClock = mClock.get();
+    rcvClock.decTN(receiveOffset);
+
+    // an empty pool drops the burst, but its samples still keep time
+    if (!rcvBurstLen) {
+      rcvBurstLen = (symbolsPerSlot + (rcvClock.TN() % 4 == 0))*samplesPerSymbol;
+      rcvBurstFill = 0;
+      for (int c = 0; c < mChans; c++) {
+        rcvBurstActive[c] = active[c];
+        rcvBurst[c] = rcvBurstActive[c] ? mRxPool->get() : NULL;
+      }
     }
-    mClock.incTN(); 
-    rcvClock.incTN();
-    //if (mReceiveFIFO.size() >= 16) mReceiveFIFO.wait(8);
-    LOG(DEBUG) << "receiveFIFO: wrote radio vector at time: " << mClock.get() << ", new size: " << mReceiveFIFO.size() ;
-    readSz += (symbolsPerSlot+(tN % 4 == 0))*samplesPerSymbol;
-    rcvSz -= (symbolsPerSlot+(tN % 4 == 0))*samplesPerSymbol;
 
-    tN = rcvClock.TN();
-  }
+    int len = rcvBurstLen - rcvBurstFill;
+    if (len > num) len = num;
+    for (int c = 0; c < mChans; c++) {
+      if (!rcvBurst[c]) continue;
+      const T *chanPtr = samples[c] + 2*offset;
+      complex *burstPtr = rcvBurst[c] + rcvBurstFill;
+      for (int i = 0; i < len; i++)
+        burstPtr[i] = complex(chanPtr[2*i+0],chanPtr[2*i+1]);
+    }
+    offset += len;
+    num -= len;
+    rcvBurstFill += len;
+
+    if (rcvBurstFill < rcvBurstLen) break;
+
+    for (int c = 0; c < mChans; c++) {
+      if (!rcvBurstActive[c]) continue;
+      if (!rcvBurst[c]) {
+        LOG(WARN) << "receive pool empty, dropping burst at time: " << rcvClock;
+      }
+      else if (rcvClock.FN() >= 0) {
+        LOG(DEEPDEBUG) << "FN: " << rcvClock.FN();
+        radioVector *rxBurst = new radioVector(mRxPool,rcvBurst[c],rcvBurstLen,rcvClock);
+        if (!mReceiveFIFO[c].put(rxBurst)) {
+          LOG(WARN) << "receive FIFO " << c << " full, dropping burst at time: " << rcvClock;
+          delete rxBurst;
+        }
+      }
+      else
+        mRxPool->put(rcvBurst[c]);
+      rcvBurst[c] = NULL;
+    }
+    rcvBurstLen = 0;
 
-  if (readSz > 0) {
-    rcvCursor -= readSz;
-    memmove(rcvBuffer,rcvBuffer+2*readSz,sizeof(float) * 2 * rcvCursor);
+    mClock.incTN(); 
+    LOG(DEBUG) << "receiveFIFO: wrote radio vector at time: " << mClock.get() << ", new size: " << mReceiveFIFO[0].size() ;
   }
 }
 
-bool RadioInterface::isUnderrun()
+template void RadioInterface::receiveSamples<short>(const short *const *samples, const bool *active, int num);
+template void RadioInterface::receiveSamples<float>(const float *const *samples, const bool *active, int num);
+
+bool RadioInterface::isUnderrun(int chan)
 {
   bool retVal = underrun;
   underrun = false;
@@ -30,28 +30,43 @@
 #include "radioDevice.h"
 #include "radioVector.h"
 #include "radioClock.h"
+#include "IQFile.h"
 
 /** samples per GSM symbol */
 #define SAMPSPERSYM 1 
 #define INCHUNK    625
 #define OUTCHUNK   625
 
+/** number of receive burst buffers, enough to fill the receive FIFO and the demodulator pipeline */
+#define RX_POOL_SIZE 128
+
+/** maximum number of ARFCNs carried by one radio */
+#define MAX_RADIO_CHANS 8
+
 /** class to interface the transceiver with the USRP */
 class RadioInterface {
 
-private:
+protected:
 
   Thread mAlignRadioServiceLoopThread;	      ///< thread that synchronizes transmit and receive sections
 
-  VectorFIFO  mReceiveFIFO;		      ///< FIFO that holds receive  bursts
+  int mChans;				      ///< number of ARFCNs, one transceiver each
+  bool mChanActive[MAX_RADIO_CHANS];	      ///< channels whose transceiver has started
+
+  VectorFIFO  mReceiveFIFO[MAX_RADIO_CHANS];  ///< FIFOs that hold receive bursts, one per channel
 
   RadioDevice *mRadio;			      ///< the USRP object
  
   float *sendBuffer;
   unsigned sendCursor;
 
-  float *rcvBuffer;
-  unsigned rcvCursor;
+  float *rcvBuffer;			      ///< resampler output, before it is split into bursts
+
+  BurstPool *mRxPool;			      ///< page aligned storage of received bursts
+  complex *rcvBurst[MAX_RADIO_CHANS];	      ///< pool buffers of the bursts being received, NULL to drop them
+  bool rcvBurstActive[MAX_RADIO_CHANS];	      ///< channels that were active when those bursts began
+  int rcvBurstLen;			      ///< length of the burst being received, in samples
+  int rcvBurstFill;			      ///< samples of that burst received so far
  
   bool underrun;			      ///< indicates writes to USRP are too slow
   bool overrun;				      ///< indicates reads from USRP are too slow
@@ -66,6 +81,7 @@ private:
   int mTransceiverOversampling;
 
   bool mOn;				      ///< indicates radio is on
+  IQCapture *mCapture;			      ///< records received samples, NULL if not capturing
 
   double powerScaling;
 
@@ -75,19 +91,28 @@ private:
                      float scale,
                      bool zero);
 
-  /** format samples from USRP */
-  int unRadioifyVector(float *floatVector, signalVector &wVector);
-
   /** push GSM bursts into the transmit buffer */
   void pushBuffer(void);
 
   /** pull GSM bursts from the receive buffer */
   void pullBuffer(void);
 
+  /** start the device and the alignment thread */
+  void startRadio();
+
+  /**
+    convert received samples straight into bursts, and queue completed ones
+    @param samples interleaved samples of each channel, all channels advance together
+    @param active channels that are started, read only when a burst begins
+    @param num number of samples per channel
+  */
+  template <typename T>
+  void receiveSamples(const T *const *samples, const bool *active, int num);
+
 public:
 
-  /** start the interface */
-  void start();
+  /** start the interface for a channel */
+  virtual void start(int chan = 0);
 
   /** constructor */
   RadioInterface(RadioDevice* wRadio = NULL,
@@ -97,25 +122,31 @@ public:
 		 GSM::Time wStartTime = GSM::Time(0));
     
   /** destructor */
-  ~RadioInterface();
+  virtual ~RadioInterface();
 
   /** check for underrun, resets underrun value */
-  bool isUnderrun();
+  virtual bool isUnderrun(int chan = 0);
   
   /** attach an existing USRP to this interface */
   void attach(RadioDevice *wRadio, int wRadioOversampling);
 
-  /** return the receive FIFO */
-  VectorFIFO* receiveFIFO() { return &mReceiveFIFO;}
+  /** return the number of channels */
+  int numChans() const { return mChans; }
+
+  /** return the receive FIFO of a channel */
+  VectorFIFO* receiveFIFO(int chan = 0) { return &mReceiveFIFO[chan];}
+
+  /** record received samples, as read from the device, before start() */
+  void capture(IQCapture *wCapture) { mCapture = wCapture; }
 
   /** return the basestation clock */
   RadioClock* getClock(void) { return &mClock;};
 
   /** set transmit frequency */
-  bool tuneTx(double freq);
+  virtual bool tuneTx(double freq, int chan = 0);
 
   /** set receive frequency */
-  bool tuneRx(double freq);
+  virtual bool tuneRx(double freq, int chan = 0);
 
   /** set receive gain */
   double setRxGain(double dB);
@@ -124,15 +155,15 @@ public:
   double getRxGain(void);
 
   /** drive transmission of GSM bursts */
-  void driveTransmitRadio(signalVector &radioBurst, bool zeroBurst);
+  virtual void driveTransmitRadio(signalVector &radioBurst, bool zeroBurst, int chan = 0);
 
   /** drive reception of GSM bursts */
-  void driveReceiveRadio();
+  virtual void driveReceiveRadio();
 
-  void setPowerAttenuation(double atten); 
+  virtual void setPowerAttenuation(double atten, int chan = 0); 
 
   /** returns the full-scale transmit amplitude **/
-  double fullScaleInputValue();
+  virtual double fullScaleInputValue();
 
   /** returns the full-scale receive amplitude **/
   double fullScaleOutputValue();
@@ -157,3 +188,93 @@ protected:
 
 /** synchronization thread loop */
 void *AlignRadioServiceLoopAdapter(RadioInterface*);
+
+class Channelizer;
+class Synthesizer;
+class Resampler;
+
+/**
+  Interface for several adjacent ARFCNs carried on one device stream.
+  Channel c is centered (c - chans/2) * 400 kHz away from the device
+  center, so ARFCNs must be two apart.  The device runs at a power of
+  two multiple of 400 kHz, at least twice the number of channels so
+  that no carrier sits near the edge of the device band.
+*/
+class RadioInterfaceMulti : public RadioInterface {
+
+private:
+
+  int mPaths;				      ///< filterbank paths, device rate over channel rate
+
+  Channelizer *mChannelizer;		      ///< splits the received stream into channels
+  Synthesizer *mSynthesizer;		      ///< combines the channels into the transmit stream
+  Resampler *mRxResampler[MAX_RADIO_CHANS];   ///< per channel 400 kHz to GSM rate converters
+  Resampler *mTxResampler[MAX_RADIO_CHANS];   ///< per channel GSM rate to 400 kHz converters
+
+  short *mRxWideBuffer;			      ///< received device samples of one chunk
+  short *mTxWideBuffer;			      ///< transmit device samples of one chunk
+  float *mRxPathBuffer[MAX_RADIO_CHANS];	      ///< received channel samples at 400 kHz
+  float *mTxPathBuffer[MAX_RADIO_CHANS];	      ///< transmit channel samples at 400 kHz
+  float *mChanBuffer[MAX_RADIO_CHANS];	      ///< received channel samples at the GSM rate
+
+  Mutex mTxLock;			      ///< serializes the transmit side of all channels
+  float *mSendBuffer[MAX_RADIO_CHANS];	      ///< transmit bursts of each channel, before resampling
+  int mSendCursor[MAX_RADIO_CHANS];	      ///< samples queued in each send buffer
+  unsigned long long mSendSkip[MAX_RADIO_CHANS]; ///< samples a channel still owes to the past, to be dropped
+  unsigned long long mSendTotal;	      ///< samples sent on each channel since the start
+  double mChanScaling[MAX_RADIO_CHANS];	      ///< digital power scaling of each channel
+  bool mChanUnderrun[MAX_RADIO_CHANS];	      ///< per channel copy of the underrun flag
+
+  Mutex mRxLock;			      ///< guards the receive handoff
+  Signal mRxSignal;			      ///< signals a chunk has been split into the receive FIFOs
+  bool mRxReading;			      ///< one channel thread is reading the device
+  unsigned long mRxChunks;		      ///< chunks read so far
+
+  bool mTxTuned;			      ///< device transmit center is set
+  bool mRxTuned;			      ///< device receive center is set
+  double mTxCenter;			      ///< device transmit center frequency
+  double mRxCenter;			      ///< device receive center frequency
+
+  /** frequency of a channel relative to the device center */
+  double chanOffset(int chan) { return (chan - mChans/2) * 400e3; }
+
+  /** filterbank path of a channel */
+  int chanPath(int chan) { return (chan - mChans/2 + mPaths) % mPaths; }
+
+  /** read and split one chunk into the receive FIFOs */
+  void pullChannels();
+
+  /** combine and write one chunk, padding lagging channels if forced */
+  void pushChannels(bool force);
+
+public:
+
+  /** number of filterbank paths, and so the device rate in units of 400 kHz, for a number of channels */
+  static int pathsFor(int chans);
+
+  /** constructor */
+  RadioInterfaceMulti(RadioDevice* wRadio,
+		      int wChans,
+		      int receiveOffset = 3,
+		      GSM::Time wStartTime = GSM::Time(0));
+
+  /** destructor */
+  ~RadioInterfaceMulti();
+
+  void start(int chan = 0);
+
+  bool isUnderrun(int chan = 0);
+
+  bool tuneTx(double freq, int chan = 0);
+
+  bool tuneRx(double freq, int chan = 0);
+
+  void driveTransmitRadio(signalVector &radioBurst, bool zeroBurst, int chan = 0);
+
+  void driveReceiveRadio();
+
+  void setPowerAttenuation(double atten, int chan = 0);
+
+  /** full scale of one channel, so that all of them together stay within the device range */
+  double fullScaleInputValue();
+};
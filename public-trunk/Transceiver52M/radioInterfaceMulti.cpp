@@ -0,0 +1,430 @@
+/*
+ * Radio device interface for several ARFCNs on one device stream
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <radioInterface.h>
+#include <Channelizer.h>
+#include <Resampler.h>
+#include <Logger.h>
+
+/*
+ * Each channel is converted between the GSM rate and the 400 kHz path
+ * rate with the same 65 / 96 resamplers as the single ARFCN interface.
+ */
+#define GSMRATE      65
+#define GSMCHUNK     (GSMRATE * 9)
+
+#define PATHRATE     96
+#define PATHCHUNK    (PATHRATE * 9)
+
+#define MAX_PATHS    (MAX_RADIO_CHANS * 2)
+
+/* Prototype filter taps per filterbank path */
+#define PATH_TAPS    24
+
+/*
+ * Transmit bursts wait until every started channel has a chunk. A
+ * channel that runs this far ahead forces the chunk out, and the
+ * lagging channels are padded with silence.
+ */
+#define SEND_BUF_LEN (GSMCHUNK * 8)
+
+/* Create a resampler with the receive or transmit low pass filter */
+static Resampler *init_resampler(bool tx)
+{
+	int P, Q, taps, chunk;
+	signalVector *lpf;
+	Resampler *resampler;
+
+	if (tx) {
+		P = PATHRATE;
+		Q = GSMRATE;
+		taps = 651;
+		chunk = GSMCHUNK;
+	} else {
+		P = GSMRATE;
+		Q = PATHRATE;
+		taps = 961;
+		chunk = PATHCHUNK;
+	}
+
+	lpf = createLPF(1.0 / (float) PATHRATE, taps, P);
+	resampler = new Resampler(P, Q, *lpf, chunk);
+	delete lpf;
+
+	return resampler;
+}
+
+int RadioInterfaceMulti::pathsFor(int chans)
+{
+	int paths = 2;
+
+	while (paths < 2 * chans)
+		paths *= 2;
+
+	return paths;
+}
+
+RadioInterfaceMulti::RadioInterfaceMulti(RadioDevice *wRadio,
+					 int wChans,
+					 int receiveOffset,
+					 GSM::Time wStartTime)
+	: RadioInterface(wRadio, receiveOffset, SAMPSPERSYM, SAMPSPERSYM,
+			 wStartTime),
+	  mChannelizer(NULL), mSynthesizer(NULL),
+	  mRxWideBuffer(NULL), mTxWideBuffer(NULL), mSendTotal(0),
+	  mRxReading(false), mRxChunks(0), mTxTuned(false), mRxTuned(false),
+	  mTxCenter(0.0), mRxCenter(0.0)
+{
+	assert((wChans > 0) && (wChans <= MAX_RADIO_CHANS));
+
+	mChans = wChans;
+	mPaths = pathsFor(wChans);
+
+	for (int i = 0; i < MAX_RADIO_CHANS; i++) {
+		mRxResampler[i] = NULL;
+		mTxResampler[i] = NULL;
+		mRxPathBuffer[i] = NULL;
+		mTxPathBuffer[i] = NULL;
+		mChanBuffer[i] = NULL;
+		mSendBuffer[i] = NULL;
+		mSendCursor[i] = 0;
+		mSendSkip[i] = 0;
+		mChanScaling[i] = 1.0;
+		mChanUnderrun[i] = false;
+	}
+}
+
+RadioInterfaceMulti::~RadioInterfaceMulti()
+{
+	for (int i = 0; i < mChans; i++) {
+		delete mRxResampler[i];
+		delete mTxResampler[i];
+		delete[] mRxPathBuffer[i];
+		delete[] mTxPathBuffer[i];
+		delete[] mChanBuffer[i];
+		delete[] mSendBuffer[i];
+	}
+
+	delete mChannelizer;
+	delete mSynthesizer;
+	delete[] mRxWideBuffer;
+	delete[] mTxWideBuffer;
+}
+
+/*
+ * The device starts with the first channel. A channel started later
+ * has its transmit deadline at the common start time, so it drops the
+ * bursts for the time that has already gone out on the air.
+ */
+void RadioInterfaceMulti::start(int chan)
+{
+	mTxLock.lock();
+
+	if (!mOn) {
+		LOG(INFO) << "starting " << mChans << " channels on "
+			  << mPaths << " filterbank paths";
+
+		startRadio();
+
+		mChannelizer = new Channelizer(mPaths, PATH_TAPS, PATHCHUNK);
+		mSynthesizer = new Synthesizer(mPaths, PATH_TAPS, PATHCHUNK);
+		mRxWideBuffer = new short[2 * PATHCHUNK * mPaths];
+		mTxWideBuffer = new short[2 * PATHCHUNK * mPaths];
+
+		for (int i = 0; i < mChans; i++) {
+			mRxResampler[i] = init_resampler(false);
+			mTxResampler[i] = init_resampler(true);
+			mRxPathBuffer[i] = new float[2 * PATHCHUNK];
+			mTxPathBuffer[i] = new float[2 * PATHCHUNK];
+			mChanBuffer[i] = new float[2 * GSMCHUNK];
+			mSendBuffer[i] = new float[2 * SEND_BUF_LEN];
+			memset(mSendBuffer[i], 0, 2 * SEND_BUF_LEN * sizeof(float));
+		}
+
+		mRxPool = new BurstPool(RX_POOL_SIZE * mChans,
+					(gSlotLen + 9) * samplesPerSymbol);
+
+		/* Receive timestamps absorb the delay of both filterbanks */
+		readTimestamp += mChannelizer->roundTripDelay();
+
+		/* Channel power is set digitally, keep the shared gain at full */
+		mRadio->setTxGain(mRadio->maxTxGain());
+
+		mOn = true;
+	}
+
+	if (!mChanActive[chan]) {
+		LOG(INFO) << "starting channel " << chan;
+		mSendSkip[chan] = mSendTotal;
+		mSendCursor[chan] = 0;
+		mChanActive[chan] = true;
+	}
+
+	mTxLock.unlock();
+}
+
+bool RadioInterfaceMulti::isUnderrun(int chan)
+{
+	bool retVal = mChanUnderrun[chan];
+	mChanUnderrun[chan] = false;
+
+	return retVal;
+}
+
+/*
+ * The first channel tuned sets the device center. All others must then
+ * fall on the filterbank grid around it.
+ */
+bool RadioInterfaceMulti::tuneTx(double freq, int chan)
+{
+	double center = freq - chanOffset(chan);
+
+	if (!mTxTuned) {
+		if (!mRadio->setTxFreq(center))
+			return false;
+		mTxCenter = center;
+		mTxTuned = true;
+		return true;
+	}
+
+	if (fabs(center - mTxCenter) > 1.0) {
+		LOG(ALARM) << "channel " << chan << " transmit frequency " << freq
+			   << " is off the channel grid around " << mTxCenter;
+		return false;
+	}
+
+	return true;
+}
+
+bool RadioInterfaceMulti::tuneRx(double freq, int chan)
+{
+	double center = freq - chanOffset(chan);
+
+	if (!mRxTuned) {
+		if (!mRadio->setRxFreq(center))
+			return false;
+		mRxCenter = center;
+		mRxTuned = true;
+		return true;
+	}
+
+	if (fabs(center - mRxCenter) > 1.0) {
+		LOG(ALARM) << "channel " << chan << " receive frequency " << freq
+			   << " is off the channel grid around " << mRxCenter;
+		return false;
+	}
+
+	return true;
+}
+
+void RadioInterfaceMulti::setPowerAttenuation(double atten, int chan)
+{
+	if (atten < 1.0)
+		mChanScaling[chan] = 1.0;
+	else
+		mChanScaling[chan] = 1.0 / sqrt(pow(10, (atten / 10.0)));
+}
+
+double RadioInterfaceMulti::fullScaleInputValue()
+{
+	return mRadio->fullScaleInputValue() / mChans;
+}
+
+void RadioInterfaceMulti::driveTransmitRadio(signalVector &radioBurst,
+					     bool zeroBurst, int chan)
+{
+	int len = radioBurst.size();
+	int skip = 0;
+	float *buf;
+
+	if (!mOn)
+		return;
+
+	mTxLock.lock();
+
+	if (!mChanActive[chan]) {
+		mTxLock.unlock();
+		return;
+	}
+
+	if (mSendSkip[chan]) {
+		skip = (mSendSkip[chan] < (unsigned) len) ? mSendSkip[chan] : len;
+		mSendSkip[chan] -= skip;
+		if (skip == len) {
+			mTxLock.unlock();
+			return;
+		}
+	}
+
+	if (mSendCursor[chan] + len > SEND_BUF_LEN) {
+		LOG(WARN) << "channel " << chan
+			  << " is ahead of the others, padding them";
+		pushChannels(true);
+	}
+
+	buf = mSendBuffer[chan] + 2 * mSendCursor[chan];
+	radioifyVector(radioBurst, buf, mChanScaling[chan], zeroBurst);
+	if (skip)
+		memmove(buf, buf + 2 * skip, 2 * (len - skip) * sizeof(float));
+	mSendCursor[chan] += len - skip;
+
+	pushChannels(false);
+
+	mTxLock.unlock();
+}
+
+/*
+ * One channel thread reads the device and fills every receive FIFO,
+ * the others wait for it and then drain their own FIFO.
+ */
+void RadioInterfaceMulti::driveReceiveRadio()
+{
+	unsigned long chunk;
+
+	if (!mOn)
+		return;
+
+	mRxLock.lock();
+	if (mRxReading) {
+		chunk = mRxChunks;
+		while (chunk == mRxChunks)
+			mRxSignal.wait(mRxLock);
+		mRxLock.unlock();
+		return;
+	}
+	mRxReading = true;
+	mRxLock.unlock();
+
+	pullChannels();
+
+	mRxLock.lock();
+	mRxReading = false;
+	mRxChunks++;
+	mRxSignal.broadcast();
+	mRxLock.unlock();
+}
+
+/* Receive a timestamped chunk and split it into the channels */
+void RadioInterfaceMulti::pullChannels()
+{
+	int i, num_rd, num_cv = 0;
+	int len = PATHCHUNK * mPaths;
+	bool local_underrun;
+	bool active[MAX_RADIO_CHANS];
+	float *paths[MAX_PATHS];
+
+	num_rd = mRadio->readSamples(mRxWideBuffer, len, &overrun,
+				     readTimestamp, &local_underrun);
+
+	LOG(DEEPDEBUG) << "Rx read " << num_rd << " samples from device";
+	assert(num_rd == len);
+
+	if (mCapture)
+		mCapture->write(mRxWideBuffer, num_rd, readTimestamp, overrun,
+				 mClock.get());
+
+	if (local_underrun) {
+		for (i = 0; i < mChans; i++)
+			mChanUnderrun[i] = true;
+	}
+	readTimestamp += (TIMESTAMP) num_rd;
+
+	for (i = 0; i < mPaths; i++)
+		paths[i] = NULL;
+	for (i = 0; i < mChans; i++)
+		paths[chanPath(i)] = mRxPathBuffer[i];
+
+	mChannelizer->rotate(mRxWideBuffer, PATHCHUNK, paths);
+
+	/* Idle channels are resampled too, to keep their filters in step */
+	for (i = 0; i < mChans; i++) {
+		num_cv = mRxResampler[i]->rotate(mRxPathBuffer[i], PATHCHUNK,
+						 mChanBuffer[i], GSMCHUNK);
+	}
+
+	/* Channels are started under the transmit lock */
+	mTxLock.lock();
+	for (i = 0; i < mChans; i++)
+		active[i] = mChanActive[i];
+	mTxLock.unlock();
+
+	receiveSamples<float>(mChanBuffer, active, num_cv);
+}
+
+/*
+ * Send timestamped chunks once every started channel has one. Channels
+ * that have not started send silence.
+ */
+void RadioInterfaceMulti::pushChannels(bool force)
+{
+	int i, num_cv = 0, num_wr, num;
+	float *paths[MAX_PATHS];
+
+	for (;;) {
+		for (i = 0; i < mChans; i++) {
+			if (mChanActive[i] && (mSendCursor[i] < GSMCHUNK))
+				break;
+		}
+		if ((i < mChans) && !force)
+			return;
+
+		for (i = 0; i < mChans; i++) {
+			if (!mChanActive[i] || (mSendCursor[i] >= GSMCHUNK))
+				continue;
+			memset(mSendBuffer[i] + 2 * mSendCursor[i], 0,
+			       2 * (GSMCHUNK - mSendCursor[i]) * sizeof(float));
+			mSendSkip[i] += GSMCHUNK - mSendCursor[i];
+			mSendCursor[i] = GSMCHUNK;
+		}
+		force = false;
+
+		for (i = 0; i < mPaths; i++)
+			paths[i] = NULL;
+		for (i = 0; i < mChans; i++) {
+			num_cv = mTxResampler[i]->rotate(mSendBuffer[i], GSMCHUNK,
+							 mTxPathBuffer[i], PATHCHUNK);
+			paths[chanPath(i)] = mTxPathBuffer[i];
+		}
+
+		num = mSynthesizer->rotate(paths, num_cv, mTxWideBuffer);
+
+		num_wr = mRadio->writeSamples(mTxWideBuffer, num,
+					      &underrun, writeTimestamp);
+
+		LOG(DEEPDEBUG) << "Tx wrote " << num_wr << " samples to device";
+		assert(num_wr == num);
+
+		if (underrun) {
+			for (i = 0; i < mChans; i++)
+				mChanUnderrun[i] = true;
+			underrun = false;
+		}
+		writeTimestamp += (TIMESTAMP) num_wr;
+		mSendTotal += GSMCHUNK;
+
+		for (i = 0; i < mChans; i++) {
+			if (!mChanActive[i])
+				continue;
+			mSendCursor[i] -= GSMCHUNK;
+			memmove(mSendBuffer[i], mSendBuffer[i] + 2 * GSMCHUNK,
+				2 * mSendCursor[i] * sizeof(float));
+		}
+	}
+}
@@ -21,11 +21,104 @@
 
 #include "radioVector.h"
 
+sharedVector::sharedVector(const signalVector& wVector)
+	: signalVector(wVector), mRefCount(1)
+{
+}
+
+void sharedVector::incRef()
+{
+	__sync_add_and_fetch(&mRefCount, 1);
+}
+
+void sharedVector::decRef()
+{
+	if (!__sync_sub_and_fetch(&mRefCount, 1))
+		delete this;
+}
+
+BurstPool::BurstPool(int num, int len)
+	: mNum(num), mLen(len), mNext(0)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	void *block;
+
+	mStride = (len * sizeof(complex) + page - 1) / page * page;
+	if (posix_memalign(&block, page, (size_t) mStride * num))
+		block = NULL;
+	assert(block);
+
+	mBlock = (char *) block;
+	mInUse = new int[num];
+	for (int i = 0; i < num; i++)
+		mInUse[i] = 0;
+}
+
+BurstPool::~BurstPool()
+{
+	free(mBlock);
+	delete[] mInUse;
+}
+
+complex *BurstPool::get()
+{
+	for (int n = 0; n < mNum; n++) {
+		int i = (mNext + n) % mNum;
+		if (!__sync_lock_test_and_set(&mInUse[i], 1)) {
+			mNext = (i + 1) % mNum;
+			return (complex *) (mBlock + (size_t) i * mStride);
+		}
+	}
+
+	return NULL;
+}
+
+void BurstPool::put(complex *buf)
+{
+	int i = ((char *) buf - mBlock) / mStride;
+
+	assert((i >= 0) && (i < mNum));
+	__sync_lock_release(&mInUse[i]);
+}
+
 radioVector::radioVector(const signalVector& wVector, GSM::Time& wTime)
-	: signalVector(wVector), mTime(wTime)
+	: signalVector(wVector), mTime(wTime), mShared(NULL),
+	  mPool(NULL), mPoolBuffer(NULL)
 {
 }
 
+/* Alias the shared samples rather than copying them */
+radioVector::radioVector(sharedVector *wVector, GSM::Time& wTime)
+	: signalVector(wVector->begin(), 0, wVector->size()),
+	  mTime(wTime), mShared(wVector), mPool(NULL), mPoolBuffer(NULL)
+{
+	mShared->incRef();
+}
+
+radioVector::radioVector(BurstPool *pool, complex *buf, int len,
+			 GSM::Time& wTime)
+	: signalVector(buf, 0, len),
+	  mTime(wTime), mShared(NULL), mPool(pool), mPoolBuffer(buf)
+{
+}
+
+radioVector::~radioVector()
+{
+	if (mShared)
+		mShared->decRef();
+	if (mPool)
+		mPool->put(mPoolBuffer);
+}
+
+sharedVector *radioVector::share()
+{
+	if (!mShared)
+		return new sharedVector(*this);
+
+	mShared->incRef();
+	return mShared;
+}
+
 GSM::Time radioVector::getTime() const
 {
 	return mTime;
@@ -41,19 +134,132 @@ bool radioVector::operator>(const radioVector& other) const
 	return mTime > other.mTime;
 }
 
+VectorFIFO::VectorFIFO(unsigned capacity)
+	: mMask(capacity - 1), mHead(0), mTail(0)
+{
+	assert(capacity && !(capacity & (capacity - 1)));
+	mRing = new radioVector*[capacity];
+}
+
+VectorFIFO::~VectorFIFO()
+{
+	while (radioVector *ptr = get())
+		delete ptr;
+	delete[] mRing;
+}
+
 unsigned VectorFIFO::size()
 {
-	return mQ.size();
+	return mTail - mHead;
 }
 
-void VectorFIFO::put(radioVector *ptr)
+/*
+ * The indices run freely and wrap as unsigned integers. The barriers
+ * order the slot access against the index update that hands the slot
+ * to the other side.
+ */
+bool VectorFIFO::put(radioVector *ptr)
 {
-	mQ.put((void*) ptr);
+	unsigned tail = mTail;
+
+	if (tail - mHead > mMask)
+		return false;
+
+	mRing[tail & mMask] = ptr;
+	__sync_synchronize();
+	mTail = tail + 1;
+
+	return true;
 }
 
 radioVector *VectorFIFO::get()
 {
-	return (radioVector*) mQ.get();
+	unsigned head = mHead;
+
+	if (head == mTail)
+		return NULL;
+
+	__sync_synchronize();
+	radioVector *ptr = mRing[head & mMask];
+	__sync_synchronize();
+	mHead = head + 1;
+
+	return ptr;
+}
+
+VectorCache::VectorCache(unsigned wSize)
+	: mSize(wSize)
+{
+	mTable = new entry[mSize];
+	for (unsigned i = 0; i < mSize; i++)
+		mTable[i].vector = NULL;
+}
+
+VectorCache::~VectorCache()
+{
+	for (unsigned i = 0; i < mSize; i++) {
+		if (mTable[i].vector)
+			mTable[i].vector->decRef();
+	}
+	delete[] mTable;
+}
+
+/* Pack the bits into the key and fold everything into a table index */
+unsigned VectorCache::hash(const BitVector& bits, int TN, int RSSI,
+			   uint64_t *key)
+{
+	unsigned i, len;
+	uint64_t h = ((uint64_t) TN << 8) ^ (uint64_t) RSSI;
+
+	assert(bits.size() <= 64 * KEYWORDS);
+
+	for (i = 0; i < KEYWORDS; i++) {
+		len = 0;
+		if (bits.size() > 64 * i)
+			len = bits.size() - 64 * i;
+		if (len > 64)
+			len = 64;
+
+		key[i] = len ? bits.peekField(64 * i, len) : 0;
+		h = (h ^ key[i]) * 0x100000001b3ULL;
+	}
+
+	return (unsigned) (h ^ (h >> 32)) % mSize;
+}
+
+sharedVector *VectorCache::find(const BitVector& bits, int TN, int RSSI)
+{
+	uint64_t key[KEYWORDS];
+	entry *e = &mTable[hash(bits, TN, RSSI, key)];
+
+	if (!e->vector || (e->len != bits.size()) ||
+	    (e->TN != TN) || (e->RSSI != RSSI))
+		return NULL;
+
+	for (unsigned i = 0; i < KEYWORDS; i++) {
+		if (e->key[i] != key[i])
+			return NULL;
+	}
+
+	e->vector->incRef();
+	return e->vector;
+}
+
+void VectorCache::insert(const BitVector& bits, int TN, int RSSI,
+			 sharedVector *wVector)
+{
+	uint64_t key[KEYWORDS];
+	entry *e = &mTable[hash(bits, TN, RSSI, key)];
+
+	wVector->incRef();
+	if (e->vector)
+		e->vector->decRef();
+
+	memcpy(e->key, key, sizeof(key));
+	e->len = bits.size();
+	e->TN = TN;
+	e->RSSI = RSSI;
+	e->vector = wVector;
 }
 
 GSM::Time VectorQueue::nextTime() const
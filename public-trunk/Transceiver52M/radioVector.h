@@ -25,25 +25,152 @@
 #include "sigProcLib.h"
 #include "GSMCommon.h"
 
+/*
+ * Reference counted waveform
+ *
+ * Modulated bursts are shared between the modulation cache, the transmit
+ * queue and the filler table. Ownership is released through decRef(),
+ * which deletes the vector when the last reference is dropped.
+ */
+class sharedVector : public signalVector {
+public:
+	sharedVector(const signalVector& wVector);
+	void incRef();
+	void decRef();
+
+private:
+	~sharedVector() { }
+	int mRefCount;
+};
+
+/*
+ * Pool of page aligned receive burst buffers
+ *
+ * Received samples are converted straight into a pool buffer, which the
+ * burst then aliases, so samples are not copied again on their way to
+ * the demodulator. Only the radio thread takes buffers. Any thread may
+ * return one, and neither side takes a lock.
+ */
+class BurstPool {
+public:
+	/* num - number of buffers, len - complex samples per buffer */
+	BurstPool(int num, int len);
+	~BurstPool();
+
+	/* Take a free buffer, or return NULL if all are in use */
+	complex *get();
+
+	/* Return a buffer taken by get() */
+	void put(complex *buf);
+
+	int length() const { return mLen; }
+
+private:
+	char *mBlock;			/* all buffers, one per page run */
+	volatile int *mInUse;
+	int mNum;
+	int mLen;
+	int mStride;			/* bytes between buffers */
+	int mNext;			/* where the next search starts */
+};
+
 class radioVector : public signalVector {
 public:
 	radioVector(const signalVector& wVector, GSM::Time& wTime);
+	radioVector(sharedVector *wVector, GSM::Time& wTime);
+
+	/* Alias len samples of a pool buffer, returned to the pool on deletion */
+	radioVector(BurstPool *pool, complex *buf, int len, GSM::Time& wTime);
+	~radioVector();
 	GSM::Time getTime() const;
 	void setTime(const GSM::Time& wTime);
 	bool operator>(const radioVector& other) const;
 
+	/* Return a new reference to the samples, sharing them if possible */
+	sharedVector *share();
+
 private:
 	GSM::Time mTime;
+	sharedVector *mShared;
+	BurstPool *mPool;
+	complex *mPoolBuffer;
 };
 
+/*
+ * Bounded single producer, single consumer queue of bursts
+ *
+ * Only the producer writes the tail and only the consumer writes the
+ * head, and the two indices sit on separate cache lines, so neither
+ * side takes a lock or waits on the other. A full queue rejects the
+ * burst rather than stalling the radio. Bursts left in the queue are
+ * deleted with it.
+ */
 class VectorFIFO {
 public:
+	/* capacity - maximum number of queued bursts, a power of two */
+	VectorFIFO(unsigned capacity = 64);
+	~VectorFIFO();
+
 	unsigned size();
-	void put(radioVector *ptr);
+
+	/* Queue a burst, return false without taking it if full */
+	bool put(radioVector *ptr);
+
+	/* Return the oldest burst, or NULL if empty */
 	radioVector *get();
 
 private:
-	PointerFIFO mQ;
+	enum { CACHE_LINE = 64 };
+
+	/* Not copyable, the queue owns the ring and the queued bursts */
+	VectorFIFO(const VectorFIFO &);
+	VectorFIFO &operator=(const VectorFIFO &);
+
+	radioVector **mRing;
+	unsigned mMask;
+
+	char mPad0[CACHE_LINE];
+	volatile unsigned mHead;	/* next slot to read */
+	char mPad1[CACHE_LINE - sizeof(unsigned)];
+	volatile unsigned mTail;	/* next slot to write */
+	char mPad2[CACHE_LINE - sizeof(unsigned)];
+};
+
+/*
+ * Content addressed cache of modulated bursts
+ *
+ * Entries are keyed by the burst bits, timeslot and power attenuation,
+ * and hold one reference to their waveform. The table is direct mapped,
+ * so a colliding insert simply replaces the previous entry.
+ */
+class VectorCache {
+public:
+	VectorCache(unsigned wSize = 512);
+	~VectorCache();
+
+	/* Return a new reference to a cached waveform, or NULL on a miss */
+	sharedVector *find(const BitVector& bits, int TN, int RSSI);
+
+	/* Add a waveform to the cache, which takes its own reference */
+	void insert(const BitVector& bits, int TN, int RSSI,
+		    sharedVector *wVector);
+
+private:
+	static const unsigned KEYWORDS = 3;
+
+	struct entry {
+		uint64_t key[KEYWORDS];
+		unsigned len;
+		int TN;
+		int RSSI;
+		sharedVector *vector;
+	};
+
+	unsigned hash(const BitVector& bits, int TN, int RSSI,
+		      uint64_t *key);
+
+	entry *mTable;
+	unsigned mSize;
 };
 
 class VectorQueue : public InterthreadPriorityQueue<radioVector> {
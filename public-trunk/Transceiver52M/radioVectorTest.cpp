@@ -0,0 +1,84 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/*
+ * Stress test of the VectorFIFO between a producer and a consumer
+ * thread. Every burst carries its sequence number in its frame number,
+ * so a lost, repeated or reordered burst shows up at the consumer.
+ */
+
+#include <sched.h>
+#include <iostream>
+
+#include "radioVector.h"
+#include <Threads.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+static const unsigned gNumBursts = 2000000;
+
+static VectorFIFO gFIFO(16);
+static unsigned gFull = 0;
+
+static GSM::Time seqTime(unsigned seq)
+{
+	return GSM::Time(seq % GSM::gHyperframe, 0);
+}
+
+void *producer(void *)
+{
+	signalVector samples(1);
+
+	for (unsigned i = 0; i < gNumBursts; i++) {
+		GSM::Time time = seqTime(i);
+		radioVector *burst = new radioVector(samples, time);
+		while (!gFIFO.put(burst)) {
+			gFull++;
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	Thread producerThread;
+	producerThread.start(producer, NULL);
+
+	unsigned bad = 0;
+	for (unsigned i = 0; i < gNumBursts; i++) {
+		radioVector *burst;
+		while (!(burst = gFIFO.get()))
+			sched_yield();
+		if (!(burst->getTime() == seqTime(i)))
+			bad++;
+		delete burst;
+	}
+
+	producerThread.join();
+
+	cout << "passed " << gNumBursts << " bursts, " << bad
+	     << " lost or out of order, queue full " << gFull << " times, "
+	     << gFIFO.size() << " left" << endl;
+
+	return (bad || gFIFO.size()) ? 1 : 0;
+}
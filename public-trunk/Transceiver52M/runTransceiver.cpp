@@ -26,9 +26,12 @@
 
 #include "Transceiver.h"
 #include "radioDevice.h"
+#include "ThreadProfile.h"
+#include "SimRadioDevice.h"
 
 #include <time.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <GSMCommon.h>
 #include <Logger.h>
@@ -69,25 +72,84 @@ int main(int argc, char *argv[])
 
   // Configure logger.
   if (argc<2) {
-    cerr << argv[0] << " <logLevel> [logFilePath]" << endl;
+    cerr << argv[0] << " <logLevel> [logFilePath] [numARFCNs] [threadProfile] [device] [capture]" << endl;
     cerr << "Log levels are ERROR, ALARM, WARN, NOTICE, INFO, DEBUG, DEEPDEBUG" << endl;
+    cerr << "ARFCNs beyond the first share the radio and must be spaced two apart" << endl;
+    cerr << "A thread profile is a list of role:priority[:cpus], e.g. mlock,fifo:80:1,rx:70:2-3" << endl;
+    cerr << "The device sim[:options] replaces the radio with a loopback, e.g. sim:pace=0,snr=20,delay=2.5" << endl;
+    cerr << "A capture path[:seconds] keeps the last seconds of received samples, 10 by default" << endl;
     exit(0);
   }
   gLogInit(argv[1]);
-  if (argc>2) gSetLogFile(argv[2]);
+  if ((argc>2) && argv[2][0]) gSetLogFile(argv[2]);
+
+  int numARFCNs = (argc>3) ? atoi(argv[3]) : 1;
+  if ((numARFCNs < 1) || (numARFCNs > MAX_RADIO_CHANS)) {
+    cerr << "numARFCNs must be between 1 and " << MAX_RADIO_CHANS << endl;
+    exit(1);
+  }
+
+  if ((argc>4) && argv[4][0] && !gThreadProfile.parse(argv[4])) {
+    cerr << "bad thread profile " << argv[4] << endl;
+    exit(1);
+  }
+  gThreadProfile.lockMemory();
 
   srandom(time(NULL));
 
-  RadioDevice *usrp = RadioDevice::make(DEVICERATE);
+  // several ARFCNs run off one wideband stream through the channelizer
+  double deviceRate = DEVICERATE;
+  if (numARFCNs > 1) deviceRate = RadioInterfaceMulti::pathsFor(numARFCNs) * 400e3;
+
+  RadioDevice *usrp;
+  SimRadioDevice *sim = NULL;
+  const char *device = (argc>5) ? argv[5] : "";
+  if (!strncmp(device,"sim",3) && ((device[3]=='\0') || (device[3]==':'))) {
+    sim = new SimRadioDevice(deviceRate);
+    if (device[3] && !sim->configure(device+4)) {
+      cerr << "bad simulated device options " << device+4 << endl;
+      exit(1);
+    }
+    usrp = sim;
+  }
+  else if (device[0]) {
+    cerr << "unknown device " << device << endl;
+    exit(1);
+  }
+  else usrp = RadioDevice::make(deviceRate);
   if (!usrp->open()) {
     //delete usrp;
     return EXIT_FAILURE;
   }
-  RadioInterface* radio = new RadioInterface(usrp,3);
-  Transceiver *trx = new Transceiver(5700,"127.0.0.1",SAMPSPERSYM,GSM::Time(3,0),radio);
-  trx->receiveFIFO(radio->receiveFIFO());
-
-  trx->start();
+  RadioInterface* radio;
+  if (numARFCNs > 1) radio = new RadioInterfaceMulti(usrp,numARFCNs,3);
+  else radio = new RadioInterface(usrp,3);
+  if ((argc>6) && argv[6][0]) {
+    string path(argv[6]);
+    double seconds = 10.0;
+    size_t colon = path.rfind(':');
+    if (colon != string::npos) {
+      seconds = atof(path.c_str()+colon+1);
+      path.erase(colon);
+    }
+    IQCapture *capture = new IQCapture;
+    if ((seconds <= 0.0) || !capture->open(path.c_str(),usrp->getSampleRate(),seconds)) {
+      cerr << "cannot capture to " << argv[6] << endl;
+      exit(1);
+    }
+    radio->capture(capture);
+  }
+  // a replayed capture runs on the clock it was recorded with
+  int startFN = sim ? sim->startFN() : -1;
+  // spread demodulation over the spare cores, leaving one for the radio
+  long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+  int rxWorkers = (numCPUs > 2) ? (numCPUs-1)/numARFCNs : 1;
+  if (rxWorkers < 1) rxWorkers = 1;
+  for (int i = 0; i < numARFCNs; i++) {
+    Transceiver *trx = new Transceiver(5700,"127.0.0.1",SAMPSPERSYM,GSM::Time(3,0),radio,rxWorkers,i,startFN);
+    trx->receiveFIFO(radio->receiveFIFO(i));
+    trx->start();
+  }
   //int i = 0;
   while(!gbShutdown) { sleep(1); }//i++; if (i==60) break;}
 
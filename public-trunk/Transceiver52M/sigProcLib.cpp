@@ -30,8 +30,11 @@
 #include "GSMCommon.h"
 #include "sendLPF_961.h"
 #include "rcvLPF_651.h"
+#include "convolve.h"
+#include "FFT.h"
 
 #include <Logger.h>
+#include <Threads.h>
 
 #define TABLESIZE 1024
 
@@ -43,6 +46,7 @@ float sinTable[TABLESIZE+1];
 static const float M_PI_F = (float)M_PI;
 static const float M_2PI_F = (float)(2.0*M_PI);
 static const float M_1_2PI_F = 1/M_2PI_F;
+static const float M_LN10_F = (float)M_LN10;
 
 /** Static vectors that contain a precomputed +/- f_b/4 sinusoid */ 
 signalVector *GMSKRotation = NULL;
@@ -52,6 +56,10 @@ signalVector *GMSKReverseRotation = NULL;
 typedef struct {
   signalVector *sequence;
   signalVector *sequenceReversedConjugated;
+  fixedVector  *fixedSequence;         ///< sequenceReversedConjugated in 16-bit fixed point
+  float        fixedScale;             ///< converts fixed point correlations back to float
+  FFT          *fft;                   ///< transform for overlap-save correlation
+  float        *spectrum;              ///< transform of sequenceReversedConjugated, scaled for the inverse
   float        TOA;
   complex      gain;
 } CorrelationSequence;
@@ -59,6 +67,19 @@ typedef struct {
 CorrelationSequence *gMidambles[] = {NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL};
 CorrelationSequence *gRACHSequence = NULL;
 
+CorrelatorType gCorrelatorType = AUTO_CORRELATOR;
+
+/** Precomputed GMSK waveform segments for table driven modulation */
+typedef struct {
+  signalVector *pulse;
+  int          samplesPerSymbol;
+  complex      *segments;
+} ModulatorTable;
+
+#define MAX_MODULATOR_TABLES 4
+ModulatorTable *gModulatorTables[MAX_MODULATOR_TABLES] = {NULL,NULL,NULL,NULL};
+Mutex gModulatorTableLock;
+
 void sigProcLibDestroy(void) {
   if (GMSKRotation) {
     delete GMSKRotation;
@@ -72,6 +93,9 @@ void sigProcLibDestroy(void) {
     if (gMidambles[i]!=NULL) {
       if (gMidambles[i]->sequence) delete gMidambles[i]->sequence;
       if (gMidambles[i]->sequenceReversedConjugated) delete gMidambles[i]->sequenceReversedConjugated;
+      if (gMidambles[i]->fixedSequence) delete gMidambles[i]->fixedSequence;
+      if (gMidambles[i]->fft) delete gMidambles[i]->fft;
+      if (gMidambles[i]->spectrum) delete[] gMidambles[i]->spectrum;
       delete gMidambles[i];
       gMidambles[i] = NULL;
     }
@@ -79,9 +103,20 @@ void sigProcLibDestroy(void) {
   if (gRACHSequence) {
     if (gRACHSequence->sequence) delete gRACHSequence->sequence;
     if (gRACHSequence->sequenceReversedConjugated) delete gRACHSequence->sequenceReversedConjugated;
+    if (gRACHSequence->fixedSequence) delete gRACHSequence->fixedSequence;
+    if (gRACHSequence->fft) delete gRACHSequence->fft;
+    if (gRACHSequence->spectrum) delete[] gRACHSequence->spectrum;
     delete gRACHSequence;
     gRACHSequence = NULL;
   }
+  for (int i = 0; i < MAX_MODULATOR_TABLES; i++) {
+    if (gModulatorTables[i]!=NULL) {
+      delete gModulatorTables[i]->pulse;
+      delete[] gModulatorTables[i]->segments;
+      delete gModulatorTables[i];
+      gModulatorTables[i] = NULL;
+    }
+  }
 }
 
 
@@ -89,61 +124,33 @@ void sigProcLibDestroy(void) {
 // dB relative to 1.0.
 // if > 1.0, then return 0 dB
 float dB(float x) {
-  
-  float arg = 1.0F;
-  float dB = 0.0F;
-  
-  if (x >= 1.0F) return 0.0F;
-  if (x <= 0.0F) return -200.0F;
-
-  float prevArg = arg;
-  float prevdB = dB;
-  float stepSize = 16.0F;
-  float dBstepSize = 12.0F;
-  while (stepSize > 1.0F) {
-    do {
-      prevArg = arg;
-      prevdB = dB;
-      arg /= stepSize;
-      dB -= dBstepSize;
-    } while (arg > x);
-    arg = prevArg;
-    dB = prevdB;
-    stepSize *= 0.5F;
-    dBstepSize -= 3.0F;
-  }
- return ((arg-x)*(dB-3.0F) + (x-arg*0.5F)*dB)/(arg - arg*0.5F);
-
+  float y;
+  dBN(&x,&y,1);
+  return y;
 }
 
 // 10^(-dB/10), inverse of dB func.
 float dBinv(float x) {
-  
-  float arg = 1.0F;
-  float dB = 0.0F;
-  
-  if (x >= 0.0F) return 1.0F;
-  if (x <= -200.0F) return 0.0F;
+  float y;
+  dBinvN(&x,&y,1);
+  return y;
+}
 
-  float prevArg = arg;
-  float prevdB = dB;
-  float stepSize = 16.0F;
-  float dBstepSize = 12.0F;
-  while (stepSize > 1.0F) {
-    do {
-      prevArg = arg;
-      prevdB = dB;
-      arg /= stepSize;
-      dB -= dBstepSize;
-    } while (dB > x);
-    arg = prevArg;
-    dB = prevdB;
-    stepSize *= 0.5F;
-    dBstepSize -= 3.0F;
+// clamps are done with min/max so the loops compile without branches
+void dBN(const float *x, float *y, int n)
+{
+  for (int i = 0; i < n; i++) {
+    float arg = fmaxf(x[i],1.0e-20F);
+    y[i] = fminf(10.0F*log10f(arg),0.0F);
   }
+}
 
-  return ((dB-x)*(arg*0.5F)+(x-(dB-3.0F))*(arg))/3.0F;
-
+void dBinvN(const float *x, float *y, int n)
+{
+  for (int i = 0; i < n; i++) {
+    float arg = fminf(x[i],0.0F);
+    y[i] = expf(arg*(M_LN10_F/10.0F))*(float) (arg > -200.0F);
+  }
 }
 
 float vectorNorm2(const signalVector &x) 
@@ -162,16 +169,23 @@ float vectorPower(const signalVector &x)
   return vectorNorm2(x)/x.size();
 }
 
+/** find the table entry and interpolation weight of a phase,
+    reducing the phase by whole turns without loops or branches */
+static inline void tableIndex(float x, int &argI, float &delta)
+{
+  const float argT = x*(M_1_2PI_F*(float)TABLESIZE);
+  int turnI = (int)argT;
+  turnI -= (argT < (float)turnI);
+  delta = argT-turnI;
+  argI = turnI & (TABLESIZE-1);
+}
+
 /** compute cosine via lookup table */
 float cosLookup(const float x)
 {
-  float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
-  while (arg < 0.0F) arg += 1.0F;
-
-  const float argT = arg*((float)TABLESIZE);
-  const int argI = (int)argT;
-  const float delta = argT-argI;
+  int argI;
+  float delta;
+  tableIndex(x,argI,delta);
   const float iDelta = 1.0F-delta;
   return iDelta*cosTable[argI] + delta*cosTable[argI+1];
 }
@@ -179,31 +193,35 @@ float cosLookup(const float x)
 /** compute sine via lookup table */
 float sinLookup(const float x) 
 {
-  float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
-  while (arg < 0.0F) arg += 1.0F;
-
-  const float argT = arg*((float)TABLESIZE);
-  const int argI = (int)argT;
-  const float delta = argT-argI;
+  int argI;
+  float delta;
+  tableIndex(x,argI,delta);
   const float iDelta = 1.0F-delta;
   return iDelta*sinTable[argI] + delta*sinTable[argI+1];
 }
 
 
-/** compute e^(-jx) via lookup table. */
+/** compute e^(jx) via lookup table. */
 complex expjLookup(float x)
 {
-  float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
-  while (arg < 0.0F) arg += 1.0F;
-
-  const float argT = arg*((float)TABLESIZE);
-  const int argI = (int)argT;
-  const float delta = argT-argI;
+  int argI;
+  float delta;
+  tableIndex(x,argI,delta);
   const float iDelta = 1.0F-delta;
-   return complex(iDelta*cosTable[argI] + delta*cosTable[argI+1],
+  return complex(iDelta*cosTable[argI] + delta*cosTable[argI+1],
+		 iDelta*sinTable[argI] + delta*sinTable[argI+1]);
+}
+
+void expjLookupN(const float *phases, complex *y, int n)
+{
+  for (int i = 0; i < n; i++) {
+    int argI;
+    float delta;
+    tableIndex(phases[i],argI,delta);
+    const float iDelta = 1.0F-delta;
+    y[i] = complex(iDelta*cosTable[argI] + delta*cosTable[argI+1],
 		   iDelta*sinTable[argI] + delta*sinTable[argI+1]);
+  }
 }
 
 /** Library setup functions */
@@ -219,15 +237,19 @@ void initGMSKRotationTables(int samplesPerSymbol) {
   GMSKReverseRotation = new signalVector(157*samplesPerSymbol);
   signalVector::iterator rotPtr = GMSKRotation->begin();
   signalVector::iterator revPtr = GMSKReverseRotation->begin();
-  float phase = 0.0;
-  while (rotPtr != GMSKRotation->end()) {
-    *rotPtr++ = expjLookup(phase);
-    *revPtr++ = expjLookup(-phase);
-    phase += M_PI_F/2.0F/(float) samplesPerSymbol;
-  }
+  int len = GMSKRotation->size();
+  float phases[len];
+  for (int i = 0; i < len; i++)
+    phases[i] = i*M_PI_F/2.0F/(float) samplesPerSymbol;
+  expjLookupN(phases,rotPtr,len);
+  for (int i = 0; i < len; i++)
+    phases[i] = -phases[i];
+  expjLookupN(phases,revPtr,len);
 }
 
 void sigProcLibSetup(int samplesPerSymbol) {
+  const struct convolve_kernels *kernels = convolve_init();
+  LOG(INFO) << "using " << kernels->name << " convolution kernels";
   initTrigTables();
   initGMSKRotationTables(samplesPerSymbol);
 }
@@ -328,49 +350,33 @@ signalVector* convolve(const signalVector *a,
   switch (b->getSymmetry()) {
   case NONE:
     {
+      // reverse the filter so both operands are walked forward,
+      //   then hand each output sample to the selected dot product kernel
+      complex bRev[Lb];
+      for (int k = 0; k < Lb; k++) 
+	bRev[k] = bStart[Lb-1-k];
+
+      bool aReal = a->isRealOnly();
+      bool bReal = b->isRealOnly();
       while (t < stopIndex) {
-	signalVector::const_iterator aP = aStart+t;
-	signalVector::const_iterator bP = bStart;
-	if (a->isRealOnly() && b->isRealOnly()) {
-	  float sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (aP->real())*(bP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (a->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*bP)*(aP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (b->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(bP->real());
-	    aP--;
-	    bP++;
+	int lo = (t-Lb+1 > 0) ? t-Lb+1 : 0;
+	int hi = (t < La-1) ? t : La-1;
+	float sum[2] = {0.0F, 0.0F};
+	if (hi >= lo) {
+	  const float *aP = (const float *) (aStart+lo);
+	  const float *bP = (const float *) (bRev+lo-t+Lb-1);
+	  if (aReal && bReal) {
+	    convolve_impl->dot_real(aP,bP,hi-lo+1,sum);
+	    sum[1] = 0.0F;
 	  }
-	  *cPtr++ = sum;
-	}
-	else {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(*bP);
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
+	  else if (aReal) 
+	    convolve_impl->dot_real(bP,aP,hi-lo+1,sum);
+	  else if (bReal)
+	    convolve_impl->dot_real(aP,bP,hi-lo+1,sum);
+	  else
+	    convolve_impl->dot_complex(aP,bP,hi-lo+1,sum);
 	}
+	*cPtr++ = complex(sum[0],sum[1]);
 	t++;
       }
     }
@@ -457,19 +463,27 @@ signalVector* frequencyShift(signalVector *y,
 
   float phase = startPhase;
   signalVector::iterator yP = y->begin();
-  signalVector::iterator xPEnd = x->end();
   signalVector::iterator xP = x->begin();
-
-  if (x->isRealOnly()) {
-    while (xP < xPEnd) {
-      (*yP++) = expjLookup(phase)*( (xP++)->real() );
+  int numSamples = x->size();
+
+  // rotate in blocks, looking up a whole block of phases at once
+  const int blockLen = 64;
+  float phases[blockLen];
+  complex rotation[blockLen];
+  for (int i = 0; i < numSamples; i += blockLen) {
+    int len = (numSamples-i < blockLen) ? numSamples-i : blockLen;
+    for (int k = 0; k < len; k++) {
+      phases[k] = phase;
       phase += freq;
     }
-  }
-  else {
-    while (xP < xPEnd) {
-      (*yP++) = (*xP++)*expjLookup(phase);
-      phase += freq;
+    expjLookupN(phases,rotation,len);
+    if (x->isRealOnly()) {
+      for (int k = 0; k < len; k++)
+        yP[i+k] = rotation[k]*(xP[i+k].real());
+    }
+    else {
+      for (int k = 0; k < len; k++)
+        yP[i+k] = xP[i+k]*rotation[k];
     }
   }
 
@@ -527,6 +541,15 @@ signalVector* correlate(signalVector *a,
 }
 
 
+/* soft output slicer for a single symbol */
+static inline float softSlice(const complex &x)
+{
+  float val = 0.5F*(x.real()+1.0F);
+  if (val > 1.0F) return 1.0F;
+  if (val < 0.0F) return 0.0F;
+  return val;
+}
+
 /* soft output slicer */
 bool vectorSlicer(signalVector *x) 
 {
@@ -534,23 +557,21 @@ bool vectorSlicer(signalVector *x)
   signalVector::iterator xP = x->begin();
   signalVector::iterator xPEnd = x->end();
   while (xP < xPEnd) {
-    *xP = (complex) (0.5*(xP->real()+1.0F));
-    if (xP->real() > 1.0) *xP = 1.0;
-    if (xP->real() < 0.0) *xP = 0.0;
+    *xP = (complex) softSlice(*xP);
     xP++;
   }
   return true;
 }
   
-signalVector *modulateBurst(const BitVector &wBurst,
-			    const signalVector &gsmPulse,
-			    int guardPeriodLength,
-			    int samplesPerSymbol)
+signalVector *modulateBurstConvolve(const BitVector &wBurst,
+				    const signalVector &gsmPulse,
+				    int guardPeriodLength,
+				    int samplesPerSymbol)
 {
 
-  static complex staticBurst[157];
-
   int burstSize = samplesPerSymbol*(wBurst.size()+guardPeriodLength);
+  complex staticBurst[burstSize];
+
   signalVector modBurst((complex *) staticBurst,0,burstSize);
   //signalVector *modBurst = new signalVector(burstSize);
   modBurst.isRealOnly(true);
@@ -592,6 +613,125 @@ signalVector *modulateBurst(const BitVector &wBurst,
 
 }
 
+/*
+  With a pulse no longer than two symbol periods, each output sample only
+  sees the symbol it falls on and its two neighbours.  After the pi/2
+  rotation is factored out as a quadrant rotation of the whole symbol
+  period, the waveform of that period depends only on the three neighbour
+  values (-1, 0 or +1, where 0 lies outside the burst) and the sample
+  phase, so all 27 windows are shaped once per pulse.
+*/
+static ModulatorTable *buildModulatorTable(const signalVector &gsmPulse,
+					   int samplesPerSymbol)
+{
+  int Lb = gsmPulse.size();
+  int center = (Lb % 2) ? Lb/2 : Lb/2-1;
+
+  // the table covers a window of one symbol on either side
+  if ((center > samplesPerSymbol) || (Lb-center > 2*samplesPerSymbol))
+    return NULL;
+
+  ModulatorTable *table = new ModulatorTable;
+  table->pulse = new signalVector(gsmPulse);
+  table->samplesPerSymbol = samplesPerSymbol;
+  table->segments = new complex[27*samplesPerSymbol];
+
+  static const complex quadrant[3] = {complex(0.0,-1.0),
+                                      complex(1.0,0.0),
+                                      complex(0.0,1.0)};
+  for (int w = 0; w < 27; w++) {
+    int symbol[3] = {w/9-1, (w/3)%3-1, w%3-1};
+    for (int r = 0; r < samplesPerSymbol; r++) {
+      complex sum = 0.0;
+      for (int d = -1; d <= 1; d++) {
+        int k = r + center - d*samplesPerSymbol;
+        if ((k < 0) || (k >= Lb) || !symbol[d+1]) continue;
+        sum += quadrant[d+1] * (gsmPulse[k].real()*symbol[d+1]);
+      }
+      table->segments[w*samplesPerSymbol+r] = sum;
+    }
+  }
+
+  return table;
+}
+
+/* find the table for a pulse, building it on first use */
+static const ModulatorTable *findModulatorTable(const signalVector &gsmPulse,
+						int samplesPerSymbol)
+{
+  gModulatorTableLock.lock();
+
+  const ModulatorTable *found = NULL;
+  int i;
+  for (i = 0; i < MAX_MODULATOR_TABLES; i++) {
+    ModulatorTable *table = gModulatorTables[i];
+    if (table==NULL) break;
+    if ((table->samplesPerSymbol != samplesPerSymbol) ||
+        (table->pulse->size() != gsmPulse.size())) continue;
+    if (!memcmp(table->pulse->begin(),gsmPulse.begin(),
+                gsmPulse.size()*sizeof(complex))) {
+      found = table;
+      break;
+    }
+  }
+  if ((found==NULL) && (i < MAX_MODULATOR_TABLES)) {
+    gModulatorTables[i] = buildModulatorTable(gsmPulse,samplesPerSymbol);
+    found = gModulatorTables[i];
+  }
+
+  gModulatorTableLock.unlock();
+  return found;
+}
+
+signalVector *modulateBurst(const BitVector &wBurst,
+			    const signalVector &gsmPulse,
+			    int guardPeriodLength,
+			    int samplesPerSymbol)
+{
+  const ModulatorTable *table = findModulatorTable(gsmPulse,samplesPerSymbol);
+  if (table==NULL)
+    return modulateBurstConvolve(wBurst,gsmPulse,
+                                 guardPeriodLength,samplesPerSymbol);
+
+  int numBits = wBurst.size();
+  int numSymbols = numBits+guardPeriodLength;
+  signalVector *shapedBurst = new signalVector(samplesPerSymbol*numSymbols);
+  signalVector::iterator burstItr = shapedBurst->begin();
+
+  // ternary window of the previous, current and next symbol
+  int prev = 1;
+  int curr = 1;
+  int next = (numBits > 0) ? 2*(wBurst[0] & 0x01) : 1;
+  for (int i = 0; i < numSymbols; i++) {
+    prev = curr;
+    curr = next;
+    next = (i+1 < numBits) ? 2*(wBurst[i+1] & 0x01) : 1;
+    const complex *segment = table->segments + (9*prev+3*curr+next)*samplesPerSymbol;
+
+    // rotate by j^i
+    switch (i & 0x03) {
+      case 0:
+        for (int r = 0; r < samplesPerSymbol; r++)
+          *burstItr++ = segment[r];
+        break;
+      case 1:
+        for (int r = 0; r < samplesPerSymbol; r++)
+          *burstItr++ = complex(-segment[r].imag(),segment[r].real());
+        break;
+      case 2:
+        for (int r = 0; r < samplesPerSymbol; r++)
+          *burstItr++ = complex(-segment[r].real(),-segment[r].imag());
+        break;
+      case 3:
+        for (int r = 0; r < samplesPerSymbol; r++)
+          *burstItr++ = complex(segment[r].imag(),-segment[r].real());
+        break;
+    }
+  }
+
+  return shapedBurst;
+}
+
 float sinc(float x) 
 {
   if ((x >= 0.01F) || (x <= -0.01F)) return (sinLookup(x)/x);
@@ -608,14 +748,14 @@ void delayVector(signalVector &wBurst,
   // do fractional shift first, only do it for reasonable offsets
   if (fabs(fracOffset) > 1e-2) {
     // create sinc function
-    static complex staticData[21];
+    complex staticData[21];
     signalVector sincVector(staticData,0,21); 
     sincVector.isRealOnly(true);
     signalVector::iterator sincBurstItr = sincVector.begin();
     for (int i = 0; i < 21; i++) 
       *sincBurstItr++ = (complex) sinc(M_PI_F*(i-10-fracOffset));
   
-    static complex shiftedData[300];
+    complex shiftedData[wBurst.size()];
     signalVector shiftedBurst(shiftedData,0,wBurst.size());
     convolve(&wBurst,&sincVector,&shiftedBurst,NO_DELAY);
     wBurst.clone(shiftedBurst);
@@ -801,6 +941,162 @@ void offsetVector(signalVector &x,
   }
 }
 
+/*
+  Quantize a correlation sequence to 16 bits.  The sequence is scaled so
+  that the sum of the magnitudes of its I and Q parts stays below full
+  scale, after which no correlation against a 16-bit burst can overflow
+  a 32-bit accumulator.
+*/
+static fixedVector *quantizeSequence(const signalVector &x, float *scale)
+{
+  float norm = 0.0;
+  for (unsigned i = 0; i < x.size(); i++)
+    norm += fabsf(x[i].real()) + fabsf(x[i].imag());
+
+  // leave room for rounding up of every tap
+  float gain = (32767.0F - x.size())/norm;
+  fixedVector *y = new fixedVector(x.size());
+  for (unsigned i = 0; i < x.size(); i++)
+    (*y)[i] = complex16((short) rintf(x[i].real()*gain),
+                        (short) rintf(x[i].imag()*gain));
+  *scale = 1.0F/gain;
+
+  return y;
+}
+
+/*
+  Fixed point analog of the NONE case of convolve(), computing outputs
+  startIndex to startIndex+c.size()-1 with 32-bit accumulation.
+*/
+static void convolveFixed(const complex16 *a, int La,
+                          const fixedVector &b, float scale,
+                          int startIndex, signalVector &c)
+{
+  int Lb = b.size();
+  const complex16 *bStart = b.begin();
+  signalVector::iterator cPtr = c.begin();
+  for (int t = startIndex; t < startIndex + (int) c.size(); t++) {
+    int lo = (t-Lb+1 > 0) ? t-Lb+1 : 0;
+    int hi = (t < La-1) ? t : La-1;
+    int32_t re = 0, im = 0;
+    for (int k = lo; k <= hi; k++) {
+      const complex16 &x = a[k];
+      const complex16 &h = bStart[t-k];
+      re += x.r*h.r - x.i*h.i;
+      im += x.r*h.i + x.i*h.r;
+    }
+    *cPtr++ = complex(re*scale,im*scale);
+  }
+}
+
+/*
+  Set up overlap-save correlation against a sequence.  A transform of
+  four times the sequence length, at least 64 points, keeps the share of
+  each block lost to wrap around small.
+*/
+static void initCorrelationSpectrum(CorrelationSequence *seq)
+{
+  int Lb = seq->sequenceReversedConjugated->size();
+  int N = 64;
+  while (N < 4*Lb) N <<= 1;
+
+  seq->fft = new FFT(N);
+  seq->spectrum = new float[2*N];
+  for (int i = 0; i < N; i++) {
+    complex h = (i < Lb) ? (*seq->sequenceReversedConjugated)[i] : complex(0.0);
+    seq->spectrum[2*i+0] = h.real()/N;
+    seq->spectrum[2*i+1] = h.imag()/N;
+  }
+  seq->fft->forward(seq->spectrum);
+}
+
+/*
+  Overlap-save analog of convolve() with the sequence, computing outputs
+  startIndex to startIndex+c.size()-1.  Each block transforms the
+  sequence length less one samples of history plus the new input, and
+  keeps the outputs past the circular wrap around.
+*/
+static void correlateFFT(const complex *a, int La,
+                         const CorrelationSequence *seq,
+                         int startIndex, signalVector &c)
+{
+  int N = seq->fft->size();
+  int Lb = seq->sequenceReversedConjugated->size();
+  int M = N-Lb+1;
+  int stopIndex = startIndex + c.size();
+  float block[2*N];
+
+  for (int t0 = startIndex; t0 < stopIndex; t0 += M) {
+    for (int i = 0; i < N; i++) {
+      int k = t0-Lb+1+i;
+      if ((k >= 0) && (k < La)) {
+        block[2*i+0] = a[k].real();
+        block[2*i+1] = a[k].imag();
+      }
+      else {
+        block[2*i+0] = 0.0F;
+        block[2*i+1] = 0.0F;
+      }
+    }
+
+    seq->fft->forward(block);
+    for (int i = 0; i < N; i++) {
+      float re = block[2*i+0]*seq->spectrum[2*i+0] - block[2*i+1]*seq->spectrum[2*i+1];
+      float im = block[2*i+0]*seq->spectrum[2*i+1] + block[2*i+1]*seq->spectrum[2*i+0];
+      block[2*i+0] = re;
+      block[2*i+1] = im;
+    }
+    seq->fft->inverse(block);
+
+    for (int i = 0; (i < M) && (t0+i < stopIndex); i++)
+      c[t0+i-startIndex] = complex(block[2*(Lb-1+i)+0],block[2*(Lb-1+i)+1]);
+  }
+}
+
+/*
+  Correlate against a sequence, choosing between the direct and the FFT
+  method.  The direct cost grows with the search length times the
+  sequence length, the FFT cost with the search length times the log of
+  the transform size, so the FFT wins above some sequence length.  The
+  crossover constant comes from the sigProcLibTest benchmark, which
+  measures both methods with the cost ratio below at:
+    midamble, every rate and search window: ratio 0.3 to 2.0, direct
+      1.5 to 5 times faster
+    RACH, 1 and 2 sps: ratio 2.8 and 5.0, direct 1.5 to 2 times faster
+    RACH, 4 sps: ratio 9.1, FFT as fast as direct or up to 3.5 times
+      faster (28 us against 99 us)
+    RACH, 8 sps: ratio 16.8, FFT 1.3 to 1.6 times faster
+  so the FFT is taken above a ratio of 7, between the last direct and
+  the first FFT case.
+*/
+#define FFT_CORRELATOR_CROSSOVER 7.0F
+
+static void correlateSequence(const signalVector &a,
+                              const CorrelationSequence *seq,
+                              int startIndex, signalVector &c)
+{
+  bool useFFT = (gCorrelatorType == FFT_CORRELATOR);
+  if (gCorrelatorType == AUTO_CORRELATOR) {
+    int N = seq->fft->size();
+    int Lb = seq->sequenceReversedConjugated->size();
+    int log2N = 0;
+    while ((1 << log2N) < N) log2N++;
+    float directCost = (float) c.size() * Lb;
+    float fftCost = (float) ((c.size()+N-Lb)/(N-Lb+1)) * N * (log2N+1);
+    useFFT = (directCost > FFT_CORRELATOR_CROSSOVER*fftCost);
+  }
+
+  if (useFFT)
+    correlateFFT(a.begin(),a.size(),seq,startIndex,c);
+  else
+    convolve(&a,seq->sequenceReversedConjugated,&c,CUSTOM,startIndex,c.size());
+}
+
+void setCorrelatorType(CorrelatorType type)
+{
+  gCorrelatorType = type;
+}
+
 bool generateMidamble(signalVector &gsmPulse,
 		      int samplesPerSymbol,
 		      int TSC)
@@ -812,6 +1108,11 @@ bool generateMidamble(signalVector &gsmPulse,
   if (gMidambles[TSC]) {
     if (gMidambles[TSC]->sequence!=NULL) delete gMidambles[TSC]->sequence;
     if (gMidambles[TSC]->sequenceReversedConjugated!=NULL)  delete gMidambles[TSC]->sequenceReversedConjugated;
+    if (gMidambles[TSC]->fixedSequence!=NULL)  delete gMidambles[TSC]->fixedSequence;
+    if (gMidambles[TSC]->fft!=NULL)  delete gMidambles[TSC]->fft;
+    if (gMidambles[TSC]->spectrum!=NULL)  delete[] gMidambles[TSC]->spectrum;
+    delete gMidambles[TSC];
+    gMidambles[TSC] = NULL;
   }
 
   signalVector emptyPulse(1); 
@@ -845,6 +1146,9 @@ bool generateMidamble(signalVector &gsmPulse,
   gMidambles[TSC] = new CorrelationSequence;
   gMidambles[TSC]->sequence = middleMidamble;
   gMidambles[TSC]->sequenceReversedConjugated = reverseConjugate(middleMidamble);
+  gMidambles[TSC]->fixedSequence = quantizeSequence(*gMidambles[TSC]->sequenceReversedConjugated,
+                                                    &gMidambles[TSC]->fixedScale);
+  initCorrelationSpectrum(gMidambles[TSC]);
   gMidambles[TSC]->gain = peakDetect(*autocorr,&gMidambles[TSC]->TOA,NULL);
 
   LOG(DEBUG) << "midamble autocorr: " << *autocorr;
@@ -866,6 +1170,11 @@ bool generateRACHSequence(signalVector &gsmPulse,
   if (gRACHSequence) {
     if (gRACHSequence->sequence!=NULL) delete gRACHSequence->sequence;
     if (gRACHSequence->sequenceReversedConjugated!=NULL) delete gRACHSequence->sequenceReversedConjugated;
+    if (gRACHSequence->fixedSequence!=NULL) delete gRACHSequence->fixedSequence;
+    if (gRACHSequence->fft!=NULL) delete gRACHSequence->fft;
+    if (gRACHSequence->spectrum!=NULL) delete[] gRACHSequence->spectrum;
+    delete gRACHSequence;
+    gRACHSequence = NULL;
   }
 
   signalVector *RACHSeq = modulateBurst(gRACHSynchSequence,
@@ -882,6 +1191,9 @@ bool generateRACHSequence(signalVector &gsmPulse,
   gRACHSequence = new CorrelationSequence;
   gRACHSequence->sequence = RACHSeq;
   gRACHSequence->sequenceReversedConjugated = reverseConjugate(RACHSeq);
+  gRACHSequence->fixedSequence = quantizeSequence(*gRACHSequence->sequenceReversedConjugated,
+                                                  &gRACHSequence->fixedScale);
+  initCorrelationSpectrum(gRACHSequence);
   gRACHSequence->gain = peakDetect(*autocorr,&gRACHSequence->TOA,NULL);
  
   delete autocorr;
@@ -891,17 +1203,13 @@ bool generateRACHSequence(signalVector &gsmPulse,
 }
 
 				
-bool detectRACHBurst(signalVector &rxBurst,
-		     float detectThreshold,
-		     int samplesPerSymbol,
-		     complex *amplitude,
-		     float* TOA)
+/* find and validate the RACH correlation peak */
+static bool detectRACHPeak(signalVector &correlatedRACH,
+			   float detectThreshold,
+			   int samplesPerSymbol,
+			   complex *amplitude,
+			   float* TOA)
 {
- 
-  static complex staticData[500];
-
-  signalVector correlatedRACH(staticData,0,rxBurst.size());
-  correlate(&rxBurst,gRACHSequence->sequenceReversedConjugated,&correlatedRACH,NO_DELAY,true);
 
   float meanPower;
   complex peakAmpl = peakDetect(correlatedRACH,TOA,&meanPower);
@@ -943,6 +1251,42 @@ bool detectRACHBurst(signalVector &rxBurst,
   return (peakToMean > detectThreshold);
 }
 
+bool detectRACHBurst(signalVector &rxBurst,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA)
+{
+ 
+  complex staticData[rxBurst.size()];
+
+  // NO_DELAY span of the correlation
+  int Lb = gRACHSequence->sequenceReversedConjugated->size();
+  signalVector correlatedRACH(staticData,0,rxBurst.size());
+  correlateSequence(rxBurst,gRACHSequence,(Lb % 2) ? Lb/2 : Lb/2-1,correlatedRACH);
+
+  return detectRACHPeak(correlatedRACH,detectThreshold,samplesPerSymbol,amplitude,TOA);
+}
+
+bool detectRACHBurst(const fixedVector &rxBurst,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA)
+{
+
+  complex staticData[rxBurst.size()];
+
+  // same span as the NO_DELAY correlation above
+  int Lb = gRACHSequence->fixedSequence->size();
+  signalVector correlatedRACH(staticData,0,rxBurst.size());
+  convolveFixed(rxBurst.begin(),rxBurst.size(),
+		*gRACHSequence->fixedSequence,gRACHSequence->fixedScale,
+		(Lb % 2) ? Lb/2 : Lb/2-1,correlatedRACH);
+
+  return detectRACHPeak(correlatedRACH,detectThreshold,samplesPerSymbol,amplitude,TOA);
+}
+
 bool energyDetect(signalVector &rxBurst,
 		  unsigned windowLength,
 		  float detectThreshold,
@@ -961,43 +1305,81 @@ bool energyDetect(signalVector &rxBurst,
   LOG(DEEPDEBUG) << "detected energy: " << energy/windowLength;
   return (energy/windowLength > detectThreshold*detectThreshold);
 }
-  
 
-bool analyzeTrafficBurst(signalVector &rxBurst,
-			 unsigned TSC,
-			 float detectThreshold,
-			 int samplesPerSymbol,
-			 complex *amplitude,
-			 float *TOA,
-			 unsigned maxTOA,
-                         bool requestChannel,
-                         signalVector **channelResponse,
-			 float *channelResponseOffset) 
+bool energyDetect(const fixedVector &rxBurst,
+		  unsigned windowLength,
+		  float detectThreshold,
+                  float *avgPwr)
 {
 
-  assert(TSC<8);
-  assert(amplitude);
-  assert(TOA);
-  assert(gMidambles[TSC]);
+  // every 4th sample, as above
+  if (windowLength > (rxBurst.size()+3)/4) windowLength = (rxBurst.size()+3)/4;
+  if (windowLength == 0) return false;
 
+  const complex16 *windowItr = rxBurst.begin();
+  int64_t energy = 0;
+  for (unsigned i = 0; i < windowLength; i++) {
+    energy += windowItr->r*windowItr->r;
+    energy += windowItr->i*windowItr->i;
+    windowItr+=4;
+  }
+  float power = (float) energy/windowLength;
+  if (avgPwr) *avgPwr = power;
+  LOG(DEEPDEBUG) << "detected energy: " << power;
+  return (power > detectThreshold*detectThreshold);
+}
+
+void quantizeVector(const signalVector &x,
+		    fixedVector &y)
+{
+  assert(y.size() == x.size());
+  signalVector::const_iterator xP = x.begin();
+  fixedVector::iterator yP = y.begin();
+  while (xP < x.end()) {
+    float re = rintf(xP->real());
+    float im = rintf(xP->imag());
+    if (re > 32767.0F) re = 32767.0F;
+    if (re < -32768.0F) re = -32768.0F;
+    if (im > 32767.0F) im = 32767.0F;
+    if (im < -32768.0F) im = -32768.0F;
+    *yP++ = complex16((short) re,(short) im);
+    xP++;
+  }
+}
+  
+
+/* burst window searched for the midamble, and the correlation span within it */
+static void midambleWindow(unsigned TSC,
+			   int samplesPerSymbol,
+			   unsigned &maxTOA,
+			   unsigned &startIx,
+			   unsigned &windowLen,
+			   unsigned &corrStart)
+{
   if (maxTOA < 3*samplesPerSymbol) maxTOA = 3*samplesPerSymbol;
   unsigned spanTOA = maxTOA;
   if (spanTOA < 5*samplesPerSymbol) spanTOA = 5*samplesPerSymbol;
 
-  unsigned startIx = (66-spanTOA)*samplesPerSymbol;
+  startIx = (66-spanTOA)*samplesPerSymbol;
   unsigned endIx = (66+16+spanTOA)*samplesPerSymbol;
-  unsigned windowLen = endIx - startIx;
-  unsigned corrLen = 2*maxTOA+1;
+  windowLen = endIx - startIx;
 
   unsigned expectedTOAPeak = (unsigned) round(gMidambles[TSC]->TOA + (gMidambles[TSC]->sequenceReversedConjugated->size()-1)/2);
+  corrStart = expectedTOAPeak-maxTOA;
+}
 
-  signalVector burstSegment(rxBurst.begin(),startIx,windowLen);
-
-  static complex staticData[200];
-  signalVector correlatedBurst(staticData,0,corrLen);
-  correlate(&burstSegment, gMidambles[TSC]->sequenceReversedConjugated,
-					    &correlatedBurst, CUSTOM,true,
-					    expectedTOAPeak-maxTOA,corrLen);
+/* find and validate the midamble correlation peak, and estimate the channel */
+static bool analyzeMidamblePeak(signalVector &correlatedBurst,
+				unsigned TSC,
+				float detectThreshold,
+				int samplesPerSymbol,
+				complex *amplitude,
+				float *TOA,
+				unsigned maxTOA,
+				bool requestChannel,
+				signalVector **channelResponse,
+				float *channelResponseOffset)
+{
 
   float meanPower;
   *amplitude = peakDetect(correlatedBurst,TOA,&meanPower);
@@ -1075,6 +1457,89 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 		  
 }
 
+bool analyzeTrafficBurst(signalVector &rxBurst,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+			 unsigned maxTOA,
+                         bool requestChannel,
+                         signalVector **channelResponse,
+			 float *channelResponseOffset) 
+{
+
+  assert(TSC<8);
+  assert(amplitude);
+  assert(TOA);
+  assert(gMidambles[TSC]);
+
+  unsigned startIx, windowLen, corrStart;
+  midambleWindow(TSC,samplesPerSymbol,maxTOA,startIx,windowLen,corrStart);
+  unsigned corrLen = 2*maxTOA+1;
+
+  signalVector burstSegment(rxBurst.begin(),startIx,windowLen);
+
+  complex staticData[corrLen];
+  signalVector correlatedBurst(staticData,0,corrLen);
+  correlateSequence(burstSegment,gMidambles[TSC],corrStart,correlatedBurst);
+
+  return analyzeMidamblePeak(correlatedBurst,TSC,detectThreshold,samplesPerSymbol,
+			     amplitude,TOA,maxTOA,
+			     requestChannel,channelResponse,channelResponseOffset);
+}
+
+bool analyzeTrafficBurst(const fixedVector &rxBurst,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+			 unsigned maxTOA,
+                         bool requestChannel,
+                         signalVector **channelResponse,
+			 float *channelResponseOffset) 
+{
+
+  assert(TSC<8);
+  assert(amplitude);
+  assert(TOA);
+  assert(gMidambles[TSC]);
+
+  unsigned startIx, windowLen, corrStart;
+  midambleWindow(TSC,samplesPerSymbol,maxTOA,startIx,windowLen,corrStart);
+  unsigned corrLen = 2*maxTOA+1;
+
+  complex staticData[corrLen];
+  signalVector correlatedBurst(staticData,0,corrLen);
+  convolveFixed(rxBurst.begin()+startIx,windowLen,
+		*gMidambles[TSC]->fixedSequence,gMidambles[TSC]->fixedScale,
+		corrStart,correlatedBurst);
+
+  return analyzeMidamblePeak(correlatedBurst,TSC,detectThreshold,samplesPerSymbol,
+			     amplitude,TOA,maxTOA,
+			     requestChannel,channelResponse,channelResponseOffset);
+}
+
+bool decimateVector(signalVector &wVector,
+		    int decimationFactor,
+		    signalVector &decVector)
+{
+
+  if (decimationFactor <= 1) return false;
+  if (decVector.size()*decimationFactor > wVector.size()) return false;
+
+  // forward walk, so decVector may alias the front of wVector
+  signalVector::iterator vecItr = decVector.begin();
+  signalVector::iterator wItr = wVector.begin();
+  while (vecItr < decVector.end()) {
+    *vecItr++ = *wItr;
+    wItr += decimationFactor;
+  }
+
+  return true;
+}
+
 signalVector *decimateVector(signalVector &wVector,
 			     int decimationFactor) 
 {
@@ -1084,48 +1549,142 @@ signalVector *decimateVector(signalVector &wVector,
   signalVector *decVector = new signalVector(wVector.size()/decimationFactor);
   decVector->isRealOnly(wVector.isRealOnly());
 
-  signalVector::iterator vecItr = decVector->begin();
-  for (unsigned int i = 0; i < wVector.size();i+=decimationFactor) 
-    *vecItr++ = wVector[i];
+  decimateVector(wVector,decimationFactor,*decVector);
 
   return decVector;
 }
 
 
-SoftVector *demodulateBurst(signalVector &rxBurst,
-			 const signalVector &gsmPulse,
-			 int samplesPerSymbol,
-			 complex channel,
-			 float TOA) 
+bool demodulateBurst(signalVector &rxBurst,
+		     const signalVector &gsmPulse,
+		     int samplesPerSymbol,
+		     complex channel,
+		     float TOA,
+		     SoftVector &burstBits) 
 
 {
   scaleVector(rxBurst,((complex) 1.0)/channel);
   delayVector(rxBurst,-TOA);
 
-  signalVector *shapedBurst = &rxBurst;
-
   // shift up by a quarter of a frequency
   // ignore starting phase, since spec allows for discontinuous phase
-  GMSKReverseRotate(*shapedBurst);
+  GMSKReverseRotate(rxBurst);
+
+  // decimate in place, the symbols alias the front of the burst
+  signalVector shapedBurst(rxBurst.begin(),0,rxBurst.size()/samplesPerSymbol);
+  if (samplesPerSymbol > 1) 
+    decimateVector(rxBurst,samplesPerSymbol,shapedBurst);
+
+  if (burstBits.size() > shapedBurst.size()) return false;
+
+  LOG(DEEPDEBUG) << "shapedBurst: " << shapedBurst;
 
   // run through slicer
-  if (samplesPerSymbol > 1) {
-     signalVector *decShapedBurst = decimateVector(*shapedBurst,samplesPerSymbol);
-     shapedBurst = decShapedBurst;
+  SoftVector::iterator burstItr = burstBits.begin();
+  signalVector::iterator shapedItr = shapedBurst.begin();
+  while (burstItr < burstBits.end()) 
+    *burstItr++ = softSlice(*shapedItr++);
+
+  return true;
+
+}
+
+bool demodulateBurst(const fixedVector &rxBurst,
+		     int samplesPerSymbol,
+		     complex channel,
+		     float TOA,
+		     SoftVector &burstBits)
+{
+  int burstLen = rxBurst.size();
+  if ((int) burstBits.size() > burstLen/samplesPerSymbol) return false;
+
+  // split the advance by TOA the same way as delayVector(-TOA)
+  int   intOffset = (int) floor(-TOA);
+  float fracOffset = -TOA - intOffset;
+
+  // sinc interpolator, normalized so that 32-bit sums cannot overflow
+  short taps[21];
+  int numTaps = 21;
+  float gain;
+  if (fabs(fracOffset) > 1e-2) {
+    float sincTaps[21];
+    float norm = 0.0;
+    for (int i = 0; i < 21; i++) {
+      sincTaps[i] = sinc(M_PI_F*(i-10-fracOffset));
+      norm += fabsf(sincTaps[i]);
+    }
+    gain = (32767.0F - 21)/norm;
+    for (int i = 0; i < 21; i++)
+      taps[i] = (short) rintf(sincTaps[i]*gain);
   }
+  else {
+    numTaps = 1;
+    gain = 32767.0F;
+    taps[0] = 32767;
+  }
+  int center = numTaps/2;
+
+  // channel correction as a 16-bit coefficient with a power of two scale
+  complex g = ((complex) 1.0)/(channel*gain);
+  float gMax = (fabsf(g.real()) > fabsf(g.imag())) ? fabsf(g.real()) : fabsf(g.imag());
+  int shift;
+  frexpf(32767.0F/gMax,&shift);
+  shift--;
+  if (shift < 0) shift = 0;
+  if (shift > 46) shift = 46;
+  int64_t one = ((int64_t) 1) << shift;
+  float gr = ldexpf(g.real(),shift);
+  float gi = ldexpf(g.imag(),shift);
+  int32_t gqr = (int32_t) ((gr > 32767.0F) ? 32767.0F : ((gr < -32767.0F) ? -32767.0F : rintf(gr)));
+  int32_t gqi = (int32_t) ((gi > 32767.0F) ? 32767.0F : ((gi < -32767.0F) ? -32767.0F : rintf(gi)));
+
+  const complex16 *burst = rxBurst.begin();
+  SoftVector::iterator burstItr = burstBits.begin();
+  for (unsigned n = 0; n < burstBits.size(); n++) {
+    // interpolate the symbol, zero outside of the burst
+    int m = n*samplesPerSymbol - intOffset;
+    int32_t re = 0, im = 0;
+    if ((m >= 0) && (m < burstLen)) {
+      for (int i = 0; i < numTaps; i++) {
+        int k = m + center - i;
+        if ((k < 0) || (k >= burstLen)) continue;
+        re += burst[k].r*taps[i];
+        im += burst[k].i*taps[i];
+      }
+    }
 
-  LOG(DEEPDEBUG) << "shapedBurst: " << *shapedBurst;
+    // shift down by a quarter of a frequency, (-j)^n
+    int32_t tmp;
+    switch (n & 0x03) {
+      case 1: tmp = re; re = im; im = -tmp; break;
+      case 2: re = -re; im = -im; break;
+      case 3: tmp = re; re = -im; im = tmp; break;
+      default: break;
+    }
 
-  vectorSlicer(shapedBurst);
+    // slice the real part of the corrected symbol
+    int64_t x = (int64_t) re*gqr - (int64_t) im*gqi;
+    if (x >= one)
+      *burstItr++ = 1.0F;
+    else if (x <= -one)
+      *burstItr++ = 0.0F;
+    else
+      *burstItr++ = (float) (x+one)/(float) (2*one);
+  }
 
-  SoftVector *burstBits = new SoftVector(shapedBurst->size());
+  return true;
+}
 
-  SoftVector::iterator burstItr = burstBits->begin();
-  signalVector::iterator shapedItr = shapedBurst->begin();
-  for (; shapedItr < shapedBurst->end(); shapedItr++) 
-    *burstItr++ = shapedItr->real();
+SoftVector *demodulateBurst(signalVector &rxBurst,
+			 const signalVector &gsmPulse,
+			 int samplesPerSymbol,
+			 complex channel,
+			 float TOA) 
 
-  if (samplesPerSymbol > 1) delete shapedBurst;
+{
+  SoftVector *burstBits = new SoftVector(rxBurst.size()/samplesPerSymbol);
+
+  demodulateBurst(rxBurst,gsmPulse,samplesPerSymbol,channel,TOA,*burstBits);
 
   return burstBits;
 
@@ -1279,156 +1838,201 @@ signalVector *resampleVector(signalVector &wVector,
 
 // Assumes symbol-spaced sampling!!!
 // Based upon paper by Al-Dhahir and Cioffi
-bool designDFE(signalVector &channelResponse,
+bool designDFE(const signalVector &channelResponse,
 	       float SNRestimate,
-	       int Nf,
-	       signalVector **feedForwardFilter,
-	       signalVector **feedbackFilter)
+	       signalVector &feedForwardFilter,
+	       signalVector &feedbackFilter)
 {
-  
-  signalVector G0(Nf);
-  signalVector G1(Nf);
-  signalVector::iterator G0ptr = G0.begin();
-  signalVector::iterator G1ptr = G1.begin();
-  signalVector::iterator chanPtr = channelResponse.begin();
-
+  int Nf = feedForwardFilter.size();
   int nu = channelResponse.size()-1;
 
-  *G0ptr = 1.0/sqrtf(SNRestimate);
-  for(int j = 0; j <= nu; j++) {
-    *G1ptr = chanPtr->conj();
-    G1ptr++; chanPtr++;
-  }
-
-  signalVector *L[Nf];
-  signalVector::iterator Lptr;
-  float d;
-  for(int i = 0; i < Nf; i++) {
-    d = G0.begin()->norm2() + G1.begin()->norm2();
-    L[i] = new signalVector(Nf+nu);
-    Lptr = L[i]->begin()+i;
-    G0ptr = G0.begin(); G1ptr = G1.begin();
-    while ((G0ptr < G0.end()) &&  (Lptr < L[i]->end())) {
-      *Lptr = (*G0ptr*(G0.begin()->conj()) + *G1ptr*(G1.begin()->conj()) )/d;
-      Lptr++;
-      G0ptr++;
-      G1ptr++;
-    }
-    complex k = (*G1.begin())/(*G0.begin());
+  // the generators are only Nf long, so the channel must fit in them
+  if ((nu < 0) || (nu+1 > Nf) || ((int) feedbackFilter.size() != nu)) return false;
+
+  signalVector::const_iterator chanPtr = channelResponse.begin();
+
+  complex G0[Nf];
+  complex G1[Nf];
+  complex G1new[Nf];
+  for (int j = 0; j <= nu; j++)
+    G1[j] = chanPtr[j].conj();
+  G0[0] = 1.0/sqrtf(SNRestimate);
+
+  // rows of the Cholesky factor, row i is nonzero from column i on
+  complex L[Nf][Nf+nu];
+  float d = 0.0;
+  for (int i = 0; i < Nf; i++) {
+    d = G0[0].norm2() + G1[0].norm2();
+    for (int m = 0; (m < Nf) && (i+m < Nf+nu); m++)
+      L[i][i+m] = (G0[m]*(G0[0].conj()) + G1[m]*(G1[0].conj()))/d;
+    complex k = G1[0]/G0[0];
 
     if (i != Nf-1) {
-      signalVector G0new = G1;
-      scaleVector(G0new,k.conj());
-      addVector(G0new,G0);
-
-      signalVector G1new = G0;
-      scaleVector(G1new,k*(-1.0));
-      addVector(G1new,G1);
-      delayVector(G1new,-1.0);
-
-      scaleVector(G0new,1.0/sqrtf(1.0+k.norm2()));
-      scaleVector(G1new,1.0/sqrtf(1.0+k.norm2()));
-      G0 = G0new;
-      G1 = G1new;
+      float scale = 1.0/sqrtf(1.0+k.norm2());
+      for (int m = 0; m < Nf; m++) {
+        G1new[m] = G0[m]*(k*(-1.0)) + G1[m];
+        G0[m] = (G1[m]*(k.conj()) + G0[m])*scale;
+      }
+      // advance the second generator by one sample
+      for (int m = 0; m < Nf-1; m++)
+        G1[m] = G1new[m+1]*scale;
+      G1[Nf-1] = 0.0;
     }
   }
 
-  *feedbackFilter = new signalVector(nu);
-  L[Nf-1]->segmentCopyTo(**feedbackFilter,Nf,nu);
-  scaleVector(**feedbackFilter,(complex) -1.0);
-  conjugateVector(**feedbackFilter);
+  signalVector::iterator bPtr = feedbackFilter.begin();
+  for (int j = 0; j < nu; j++)
+    bPtr[j] = L[Nf-1][Nf+j].conj()*(-1.0);
 
-  signalVector v(Nf);
-  signalVector::iterator vStart = v.begin();
-  signalVector::iterator vPtr;
-  *(vStart+Nf-1) = (complex) 1.0;
-  for(int k = Nf-2; k >= 0; k--) {
-    Lptr = L[k]->begin()+k+1;
-    vPtr = vStart + k+1;
+  complex v[Nf];
+  v[Nf-1] = 1.0;
+  for (int k = Nf-2; k >= 0; k--) {
     complex v_k = 0.0;
-    for (int j = k+1; j < Nf; j++) {
-      v_k -= (*vPtr)*(*Lptr);
-      vPtr++; Lptr++;
-    }
-     *(vStart + k) = v_k;
+    for (int j = k+1; j < Nf; j++)
+      v_k -= v[j]*L[k][j];
+    v[k] = v_k;
   }
 
-  *feedForwardFilter = new signalVector(Nf);
-  signalVector::iterator w = (*feedForwardFilter)->begin();
+  signalVector::iterator w = feedForwardFilter.begin();
   for (int i = 0; i < Nf; i++) {
-    delete L[i];
     complex w_i = 0.0;
     int endPt = ( nu < (Nf-1-i) ) ? nu : (Nf-1-i);
-    vPtr = vStart+i;
-    chanPtr = channelResponse.begin();
-    for (int k = 0; k < endPt+1; k++) {
-      w_i += (*vPtr)*(chanPtr->conj());
-      vPtr++; chanPtr++;
+    for (int k = 0; k < endPt+1; k++)
+      w_i += v[i+k]*(chanPtr[k].conj());
+    w[i] = w_i/d;
+  }
+
+  return true;
+}
+
+bool designDFE(signalVector &channelResponse,
+	       float SNRestimate,
+	       int Nf,
+	       signalVector **feedForwardFilter,
+	       signalVector **feedbackFilter)
+{
+  *feedForwardFilter = new signalVector(Nf);
+  *feedbackFilter = new signalVector(channelResponse.size()-1);
+  return designDFE(channelResponse,SNRestimate,**feedForwardFilter,**feedbackFilter);
+}
+
+bool trackDFE(const signalVector &rxBurst,
+	      const SoftVector &burstBits,
+	      unsigned TSC,
+	      float stepSize,
+	      signalVector &w,
+	      signalVector &b,
+	      float *trainingError)
+{
+  // 3 tail bits, 57 data bits and a stealing flag precede the midamble
+  const int midambleStart = 61;
+  const BitVector &midamble = gTrainingSequence[TSC];
+  int Lm = midamble.size();
+  int Nf = w.size();
+  int Nb = b.size();
+
+  if ((midambleStart+Lm > (int) burstBits.size()) ||
+      (midambleStart+Lm+Nf-1 > (int) rxBurst.size()) ||
+      (Nb > midambleStart)) return false;
+
+  // rotated symbols seen by the feedback filter, decided ones ahead
+  //   of the midamble and the known training symbols after that
+  complex symbols[Nb+Lm];
+  signalVector::const_iterator rotPtr = GMSKRotation->begin()+midambleStart-Nb;
+  for (int m = 0; m < Nb+Lm; m++) {
+    int n = midambleStart-Nb+m;
+    bool bit = (n < midambleStart) ? (burstBits[n] > 0.5F) : midamble.bit(n-midambleStart);
+    symbols[m] = rotPtr[m]*(bit ? 1.0F : -1.0F);
+  }
+
+  signalVector::iterator wPtr = w.begin();
+  signalVector::iterator bPtr = b.begin();
+  float errorEnergy = 0.0;
+  for (int n = 0; n < Lm; n++) {
+    // w[k] takes sample n+Nf-1-k, b[j] takes symbol n-1-j
+    signalVector::const_iterator x = rxBurst.begin()+midambleStart+n+Nf-1;
+    const complex *s = symbols+Nb+n;
+    complex y = 0.0;
+    float power = 1.0e-6;
+    for (int k = 0; k < Nf; k++) {
+      y += wPtr[k]*x[-k];
+      power += x[-k].norm2();
+    }
+    for (int j = 0; j < Nb; j++) {
+      y += bPtr[j]*s[-1-j];
+      power += s[-1-j].norm2();
     }
-    *w = w_i/d;
-    w++;
+    complex e = s[0]-y;
+    errorEnergy += e.norm2();
+    complex g = e*(stepSize/power);
+    for (int k = 0; k < Nf; k++)
+      wPtr[k] += g*(x[-k].conj());
+    for (int j = 0; j < Nb; j++)
+      bPtr[j] += g*(s[-1-j].conj());
   }
 
+  if (trainingError) *trainingError = errorEnergy/Lm;
 
   return true;
-  
 }
 
 // Assumes symbol-rate sampling!!!!
-SoftVector *equalizeBurst(signalVector &rxBurst,
-		       float TOA,
-		       int samplesPerSymbol,
-		       signalVector &w, // feedforward filter
-		       signalVector &b) // feedback filter
+bool equalizeBurst(signalVector &rxBurst,
+		   float TOA,
+		   int samplesPerSymbol,
+		   signalVector &w, // feedforward filter
+		   signalVector &b, // feedback filter
+		   SoftVector &burstBits)
 {
 
-  delayVector(rxBurst,-TOA);
+  if (burstBits.size() > rxBurst.size()) return false;
 
-  signalVector* postForwardFull = convolve(&rxBurst,&w,NULL,FULL_SPAN);
+  delayVector(rxBurst,-TOA);
 
-  signalVector* postForward = new signalVector(rxBurst.size());
-  postForwardFull->segmentCopyTo(*postForward,w.size()-1,rxBurst.size());
-  delete postForwardFull;
+  // only the part of the feedforward output aligned with the burst is kept
+  complex postForwardData[rxBurst.size()];
+  signalVector postForward(postForwardData,0,rxBurst.size());
+  convolve(&rxBurst,&w,&postForward,CUSTOM,w.size()-1,rxBurst.size());
 
-  signalVector::iterator dPtr = postForward->begin();
+  signalVector::iterator dPtr = postForward.begin();
+  signalVector::iterator dEnd = postForward.begin()+burstBits.size();
   signalVector::iterator dBackPtr;
   signalVector::iterator rotPtr = GMSKRotation->begin();
   signalVector::iterator revRotPtr = GMSKReverseRotation->begin();
 
-  signalVector *DFEoutput = new signalVector(postForward->size());
-  signalVector::iterator DFEItr = DFEoutput->begin();
+  SoftVector::iterator burstItr = burstBits.begin();
 
   // NOTE: can insert the midamble and/or use midamble to estimate BER
-  for (; dPtr < postForward->end(); dPtr++) {
+  for (; dPtr < dEnd; dPtr++) {
     dBackPtr = dPtr-1;
     signalVector::iterator bPtr = b.begin();
-    while ( (bPtr < b.end()) && (dBackPtr >= postForward->begin()) ) {
+    while ( (bPtr < b.end()) && (dBackPtr >= postForward.begin()) ) {
       *dPtr = *dPtr + (*bPtr)*(*dBackPtr);
       bPtr++;
       dBackPtr--;
     }
     *dPtr = *dPtr * (*revRotPtr);
-    *DFEItr = *dPtr;
+    *burstItr++ = softSlice(*dPtr);
     // make decision on symbol
     *dPtr = (dPtr->real() > 0.0) ? 1.0 : -1.0;
-    //*DFEItr = *dPtr;
     *dPtr = *dPtr * (*rotPtr);
-    DFEItr++;
     rotPtr++;
     revRotPtr++;
   }
 
-  vectorSlicer(DFEoutput);
+  return true;
+}
 
-  SoftVector *burstBits = new SoftVector(postForward->size());
-  SoftVector::iterator burstItr = burstBits->begin();
-  DFEItr = DFEoutput->begin();
-  for (; DFEItr < DFEoutput->end(); DFEItr++) 
-    *burstItr++ = DFEItr->real();
+SoftVector *equalizeBurst(signalVector &rxBurst,
+		       float TOA,
+		       int samplesPerSymbol,
+		       signalVector &w, // feedforward filter
+		       signalVector &b) // feedback filter
+{
 
-  delete postForward;
+  SoftVector *burstBits = new SoftVector(rxBurst.size());
 
-  delete DFEoutput;
+  equalizeBurst(rxBurst,TOA,samplesPerSymbol,w,b,*burstBits);
 
   return burstBits;
 }
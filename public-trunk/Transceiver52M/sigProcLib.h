@@ -100,12 +100,41 @@ class signalVector: public Vector<complex>
   void isRealOnly(bool wOnly) { realOnly = wOnly;};
 };
 
+/** Complex sample in 16-bit fixed point */
+typedef Complex<short> complex16;
+
+/** Received samples in 16-bit fixed point, for the integer detection path */
+class fixedVector: public Vector<complex16>
+{
+
+ public:
+
+  /** Constructors */
+  fixedVector(int dSize=0):
+    Vector<complex16>(dSize)
+    { };
+
+  /** Wrap an existing block, which is NOT deleted upon destruction */
+  fixedVector(complex16 *wData, size_t span):
+    Vector<complex16>(wData,span)
+    { };
+};
+
 /** Convert a linear number to a dB value */
 float dB(float x);
 
 /** Convert a dB value into a linear value */
 float dBinv(float x);
 
+/** Convert n linear numbers to dB values, see dB() */
+void dBN(const float *x, float *y, int n);
+
+/** Convert n dB values into linear values, see dBinv() */
+void dBinvN(const float *x, float *y, int n);
+
+/** Compute e^(jx) of n phases, of any size, from the sine and cosine tables */
+void expjLookupN(const float *phases, complex *y, int n);
+
 /** Compute the energy of a vector */
 float vectorNorm2(const signalVector &x);
 
@@ -118,6 +147,16 @@ void sigProcLibSetup(int samplesPerSymbol);
 /** Destroy the signal processing library */
 void sigProcLibDestroy(void);
 
+/** Correlator used by the RACH and midamble searches */
+enum CorrelatorType {
+  AUTO_CORRELATOR,     ///< overlap-save FFT for long searches, direct otherwise
+  DIRECT_CORRELATOR,   ///< time domain dot products
+  FFT_CORRELATOR       ///< overlap-save FFT
+};
+
+/** Select the correlator of the RACH and midamble searches, AUTO_CORRELATOR by default */
+void setCorrelatorType(CorrelatorType type);
+
 /** 
  	Convolve two vectors. 
 	@param a,b The vectors to be convolved.
@@ -174,12 +213,22 @@ signalVector* correlate(signalVector *a,
 /** Operate soft slicer on real-valued portion of vector */ 
 bool vectorSlicer(signalVector *x);
 
-/** GMSK modulate a GSM burst of bits */
+/**
+        GMSK modulate a GSM burst of bits.  Waveform segments are looked up
+        from a table built once per pulse shape, falling back to
+        modulateBurstConvolve() for pulses longer than two symbols.
+*/
 signalVector *modulateBurst(const BitVector &wBurst,
 			    const signalVector &gsmPulse,
 			    int guardPeriodLength,
 			    int samplesPerSymbol);
 
+/** GMSK modulate a GSM burst of bits by filtering the rotated symbols */
+signalVector *modulateBurstConvolve(const BitVector &wBurst,
+				    const signalVector &gsmPulse,
+				    int guardPeriodLength,
+				    int samplesPerSymbol);
+
 /** Sinc function */
 float sinc(float x);
 
@@ -264,6 +313,12 @@ bool energyDetect(signalVector &rxBurst,
                   float detectThreshold,
                   float *avgPwr = NULL);
 
+/** Energy detector on a fixed point burst, see energyDetect() above. */
+bool energyDetect(const fixedVector &rxBurst,
+		  unsigned windowLength,
+                  float detectThreshold,
+                  float *avgPwr = NULL);
+
 /**
         RACH correlator/detector.
         @param rxBurst The received GSM burst of interest.
@@ -279,6 +334,13 @@ bool detectRACHBurst(signalVector &rxBurst,
 		     complex *amplitude,
 		     float* TOA);
 
+/** RACH correlator/detector with 16-bit samples and 32-bit accumulation, see detectRACHBurst() above. */
+bool detectRACHBurst(const fixedVector &rxBurst,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA);
+
 /**
         Normal burst correlator, detector, channel estimator.
         @param rxBurst The received GSM burst of interest.
@@ -304,6 +366,26 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 			 signalVector** channelResponse = NULL,
 			 float *channelResponseOffset = NULL);
 
+/** Normal burst correlator with 16-bit samples and 32-bit accumulation, see analyzeTrafficBurst() above. */
+bool analyzeTrafficBurst(const fixedVector &rxBurst,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+                         unsigned maxTOA,
+                         bool requestChannel = false,
+			 signalVector** channelResponse = NULL,
+			 float *channelResponseOffset = NULL);
+
+/**
+        Quantize a received burst to 16-bit fixed point, saturating at full scale.
+        @param x The burst, in units of the radio's full scale output.
+        @param y The fixed point burst, the same size as x.
+*/
+void quantizeVector(const signalVector &x,
+		    fixedVector &y);
+
 /**
 	Decimate a vector.
         @param wVector The vector of interest.
@@ -313,6 +395,17 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 signalVector *decimateVector(signalVector &wVector,
 			     int decimationFactor);
 
+/**
+	Decimate a vector into a preallocated vector.
+        @param wVector The vector of interest.
+        @param decimationFactor The amount of decimation, i.e. the decimation factor.
+        @param decVector The decimated vector, may alias the start of wVector.
+        @return True if decVector fits the decimated signal.
+*/
+bool decimateVector(signalVector &wVector,
+		    int decimationFactor,
+		    signalVector &decVector);
+
 /**
         Demodulates a received burst using a soft-slicer.
 	@param rxBurst The burst to be demodulated.
@@ -328,6 +421,39 @@ SoftVector *demodulateBurst(signalVector &rxBurst,
 			 complex channel,
 			 float TOA);
 
+/**
+        Demodulates a received burst into preallocated soft bits, without allocating.
+	@param rxBurst The burst to be demodulated, overwritten in the process.
+        @param gsmPulse The GSM pulse.
+        @param samplesPerSymbol The number of samples per GSM symbol.
+        @param channel The amplitude estimate of the received burst.
+        @param TOA The time-of-arrival of the received burst.
+        @param burstBits Receives the first burstBits.size() demodulated bits.
+        @return True if the burst holds enough symbols to fill burstBits.
+*/
+bool demodulateBurst(signalVector &rxBurst,
+		     const signalVector &gsmPulse,
+		     int samplesPerSymbol,
+		     complex channel,
+		     float TOA,
+		     SoftVector &burstBits);
+
+/**
+        Demodulates a fixed point burst into soft bits.  Interpolation,
+        derotation, channel correction and slicing use integer arithmetic.
+        @param rxBurst The burst to be demodulated.
+        @param samplesPerSymbol The number of samples per GSM symbol.
+        @param channel The amplitude estimate of the received burst.
+        @param TOA The time-of-arrival of the received burst.
+        @param burstBits Receives the first burstBits.size() demodulated bits.
+        @return True if the burst holds enough symbols to fill burstBits.
+*/
+bool demodulateBurst(const fixedVector &rxBurst,
+		     int samplesPerSymbol,
+		     complex channel,
+		     float TOA,
+		     SoftVector &burstBits);
+
 /**
         Creates a simple Kaiser-windowed low-pass FIR filter.
         @param cutoffFreq The digital 3dB bandwidth of the filter.
@@ -377,6 +503,40 @@ bool designDFE(signalVector &channelResponse,
 	       signalVector **feedForwardFilter,
 	       signalVector **feedbackFilter);
 
+/**
+	Design decision-feedback equalizer filters into caller storage, without allocating.
+	@param channelResponse The multipath channel that we're mitigating, no longer than the feedforward filter.
+	@param SNRestimate The signal-to-noise estimate of the channel, a linear value
+	@param feedForwardFilter Receives the feed forward filter, its size is the number of taps.
+	@param feedbackFilter Receives the feedback filter, one tap shorter than the channel.
+	@return True if DFE can be designed.
+*/
+bool designDFE(const signalVector &channelResponse,
+	       float SNRestimate,
+	       signalVector &feedForwardFilter,
+	       signalVector &feedbackFilter);
+
+/**
+	Refine decision-feedback equalizer filters with normalized LMS on a burst's midamble.
+	Costs a fixed number of operations per burst, so the filters can follow a
+	slowly changing channel without being designed again.
+	@param rxBurst The burst after equalizeBurst(), which leaves it aligned to the symbol clock.
+	@param burstBits The soft bits equalizeBurst() produced from the burst.
+	@param TSC The training sequence code of the burst.
+	@param stepSize The normalized LMS step size, between 0 and 2.
+	@param w The feed forward filter of the DFE, updated in place.
+	@param b The feedback filter of the DFE, updated in place.
+	@param trainingError Receives the mean squared error over the midamble, before the update.
+	@return True if the burst covers the midamble.
+*/
+bool trackDFE(const signalVector &rxBurst,
+	      const SoftVector &burstBits,
+	      unsigned TSC,
+	      float stepSize,
+	      signalVector &w,
+	      signalVector &b,
+	      float *trainingError);
+
 /**
 	Equalize/demodulate a received burst via a decision-feedback equalizer.
 	@param rxBurst The received burst to be demodulated.
@@ -392,4 +552,21 @@ SoftVector *equalizeBurst(signalVector &rxBurst,
 		       signalVector &w, 
 		       signalVector &b);
 
+/**
+	Equalize/demodulate a received burst into preallocated soft bits, without allocating.
+	@param rxBurst The received burst to be demodulated, overwritten in the process.
+	@param TOA The time-of-arrival of the received burst.
+	@param samplesPerSymbol The number of samples per GSM symbol.
+	@param w The feed forward filter of the DFE.
+	@param b The feedback filter of the DFE.
+	@param burstBits Receives the first burstBits.size() demodulated bits.
+	@return True if the burst holds enough symbols to fill burstBits.
+*/
+bool equalizeBurst(signalVector &rxBurst,
+		   float TOA,
+		   int samplesPerSymbol,
+		   signalVector &w, 
+		   signalVector &b,
+		   SoftVector &burstBits);
+
 #endif /* SIGPROCLIB_H */
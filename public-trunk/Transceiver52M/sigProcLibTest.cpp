@@ -26,9 +26,13 @@ Harvind S. Samra, hssamra@kestrelsp.com
 
 
 #include "sigProcLib.h"
+#include "convolve.h"
+#include "Channelizer.h"
+#include "Resampler.h"
 //#include "radioInterface.h"
 #include <Logger.h>
 #include <Configuration.h>
+#include <Timeval.h>
 
 using namespace std;
 
@@ -63,6 +67,71 @@ int main(int argc, char **argv) {
   complex a; float t;
   detectRACHBurst(*RACHSeq, 5, samplesPerSymbol,&a,&t); 
 
+  // compare the selected convolution kernels against the scalar ones
+  signalVector *noise = gaussianNoise(500,1.0);
+  const struct convolve_kernels *kernels = convolve_impl;
+  convolve_impl = &convolve_base;
+  signalVector *refCorr = correlate(noise,RACHSeq,NULL,NO_DELAY);
+  signalVector *refShaped = convolve(noise,gsmPulse,NULL,NO_DELAY);
+  convolve_impl = kernels;
+  signalVector *kernCorr = correlate(noise,RACHSeq,NULL,NO_DELAY);
+  signalVector *kernShaped = convolve(noise,gsmPulse,NULL,NO_DELAY);
+  float maxErr = 0.0;
+  for (unsigned i = 0; i < refCorr->size(); i++) {
+    float err = ((*refCorr)[i]-(*kernCorr)[i]).abs();
+    if (err > maxErr) maxErr = err;
+    err = ((*refShaped)[i]-(*kernShaped)[i]).abs();
+    if (err > maxErr) maxErr = err;
+  }
+  cout << kernels->name << " kernels, max error vs. scalar: " << maxErr << endl;
+  delete noise;
+  delete refCorr;
+  delete refShaped;
+  delete kernCorr;
+  delete kernShaped;
+
+  // compare the table driven modulator against direct filtering
+  BitVector randomBurst(148);
+  for (unsigned i = 0; i < randomBurst.size(); i++)
+    randomBurst[i] = random() & 0x01;
+  signalVector *tableBurst = modulateBurst(randomBurst,*gsmPulse,8,samplesPerSymbol);
+  signalVector *convBurst = modulateBurstConvolve(randomBurst,*gsmPulse,8,samplesPerSymbol);
+  maxErr = 0.0;
+  for (unsigned i = 0; i < tableBurst->size(); i++) {
+    float err = ((*tableBurst)[i]-(*convBurst)[i]).abs();
+    if (err > maxErr) maxErr = err;
+  }
+  cout << "modulator table, max error vs. convolution: " << maxErr << endl;
+  delete tableBurst;
+  delete convBurst;
+
+  // compare the batched trig and dB helpers against libm, over
+  //   negative and many-turn phases and the whole dB range
+  const int numPhases = 4096;
+  float phases[numPhases], linear[numPhases], logs[numPhases];
+  complex rotations[numPhases];
+  for (int i = 0; i < numPhases; i++) {
+    phases[i] = 1000.0*(i-numPhases/2)/numPhases;
+    linear[i] = pow(10.0,-20.0*i/numPhases);
+  }
+  expjLookupN(phases,rotations,numPhases);
+  dBN(linear,logs,numPhases);
+  float maxTrigErr = 0.0, maxdBErr = 0.0;
+  for (int i = 0; i < numPhases; i++) {
+    float err = (rotations[i]-complex(cos(phases[i]),sin(phases[i]))).abs();
+    if (err > maxTrigErr) maxTrigErr = err;
+    err = fabs(logs[i]-10.0*log10(linear[i]));
+    if (err > maxdBErr) maxdBErr = err;
+  }
+  dBinvN(logs,logs,numPhases);
+  float maxdBinvErr = 0.0;
+  for (int i = 0; i < numPhases; i++) {
+    float err = fabs(logs[i]-linear[i])/linear[i];
+    if (err > maxdBinvErr) maxdBinvErr = err;
+  }
+  cout << "expjLookupN, max error: " << maxTrigErr << ", dBN, max error: " << maxdBErr
+       << ", dBinvN, max relative error: " << maxdBinvErr << endl;
+
   //cout << *RACHSeq << endl;
   //signalVector *autocorr = correlate(RACHSeq,RACHSeq,NULL,NO_DELAY);
 
@@ -95,6 +164,119 @@ int main(int argc, char **argv) {
   signalVector *modBurst = modulateBurst(normalBurst,*gsmPulse,
                                          0,samplesPerSymbol);
 
+  // compare the fixed point receive path against floating point
+  signalVector rxFloat(*modBurst);
+  scaleVector(rxFloat,complex(2400.0,-1800.0));
+  signalVector *rxNoise = gaussianNoise(rxFloat.size(),10000.0);
+  addVector(rxFloat,*rxNoise);
+  fixedVector rxFixed(rxFloat.size());
+  quantizeVector(rxFloat,rxFixed);
+  complex floatAmpl, fixedAmpl;
+  float floatTOA, fixedTOA;
+  analyzeTrafficBurst(rxFloat,TSC,3.0,samplesPerSymbol,&floatAmpl,&floatTOA,1);
+  analyzeTrafficBurst(rxFixed,TSC,3.0,samplesPerSymbol,&fixedAmpl,&fixedTOA,1);
+  SoftVector floatBits(gSlotLen), fixedBits(gSlotLen);
+  demodulateBurst(rxFixed,samplesPerSymbol,fixedAmpl,fixedTOA,fixedBits);
+  demodulateBurst(rxFloat,*gsmPulse,samplesPerSymbol,floatAmpl,floatTOA,floatBits);
+  float maxBitErr = 0.0;
+  for (unsigned i = 0; i < gSlotLen; i++) {
+    float err = fabs(floatBits[i]-fixedBits[i]);
+    if (err > maxBitErr) maxBitErr = err;
+  }
+  cout << "fixed point TSC, amplitude error: " << (fixedAmpl-floatAmpl).abs()/floatAmpl.abs()
+       << ", TOA error: " << fabs(fixedTOA-floatTOA)
+       << ", max soft bit error: " << maxBitErr << endl;
+  delete rxNoise;
+
+  signalVector rxRACH(*RACHSeq);
+  scaleVector(rxRACH,complex(-1500.0,2600.0));
+  rxNoise = gaussianNoise(rxRACH.size(),10000.0);
+  addVector(rxRACH,*rxNoise);
+  fixedVector rxFixedRACH(rxRACH.size());
+  quantizeVector(rxRACH,rxFixedRACH);
+  float floatPwr, fixedPwr;
+  energyDetect(rxRACH,20*samplesPerSymbol,0.0,&floatPwr);
+  energyDetect(rxFixedRACH,20*samplesPerSymbol,0.0,&fixedPwr);
+  detectRACHBurst(rxRACH,5.0,samplesPerSymbol,&floatAmpl,&floatTOA);
+  detectRACHBurst(rxFixedRACH,5.0,samplesPerSymbol,&fixedAmpl,&fixedTOA);
+  cout << "fixed point RACH, amplitude error: " << (fixedAmpl-floatAmpl).abs()/floatAmpl.abs()
+       << ", TOA error: " << fabs(fixedTOA-floatTOA)
+       << ", energy error: " << fabs(fixedPwr-floatPwr)/floatPwr << endl;
+  delete rxNoise;
+
+  // design the equalizer once for a two path channel, then turn the
+  //   second path and compare the fixed filters against tracked ones
+  {
+    complex forwardData[7], feedbackData[5];
+    signalVector w(forwardData,0,7), b(feedbackData,0,5);
+    complex trackedForwardData[7], trackedFeedbackData[5];
+    signalVector wt(trackedForwardData,0,7), bt(trackedFeedbackData,0,5);
+    signalVector *chan = NULL;
+    float chanOffset = 0.0;
+    float staticErr = 0.0, trackedErr = 0.0, trainingErr = 0.0;
+    const int numBursts = 200;
+    signalVector *rxBurst = NULL;
+    SoftVector trackedBits(gSlotLen);
+    for (int n = 0; n <= numBursts; n++) {
+      BitVector dataBurst(normalBurst);
+      for (unsigned i = 3; i < 61; i++) {
+        dataBurst[i] = random() & 0x01;
+        dataBurst[i+84] = random() & 0x01;
+      }
+      signalVector *txBurst = modulateBurst(dataBurst,*gsmPulse,0,samplesPerSymbol);
+      signalVector paths(2);
+      paths[0] = 1.0;
+      paths[1] = complex(0.6*cos(M_PI*n/numBursts),0.6*sin(M_PI*n/numBursts));
+      delete rxBurst;
+      rxBurst = convolve(txBurst,&paths,NULL,START_ONLY);
+      signalVector *rxNoise = gaussianNoise(rxBurst->size(),0.001);
+      addVector(*rxBurst,*rxNoise);
+      complex ampl;
+      float toa;
+      analyzeTrafficBurst(*rxBurst,TSC,3.0,samplesPerSymbol,&ampl,&toa,2,(n == 0),&chan,&chanOffset);
+      scaleVector(*rxBurst,complex(1.0,0.0)/ampl);
+      if (n == 0) {
+        scaleVector(*chan,complex(1.0,0.0)/ampl);
+        designDFE(*chan,1000.0,w,b);
+        for (int i = 0; i < 7; i++) wt[i] = w[i];
+        for (int i = 0; i < 5; i++) bt[i] = b[i];
+      }
+      else {
+        signalVector staticBurst(*rxBurst);
+        SoftVector staticBits(gSlotLen);
+        equalizeBurst(staticBurst,toa-chanOffset,samplesPerSymbol,w,b,staticBits);
+        equalizeBurst(*rxBurst,toa-chanOffset,samplesPerSymbol,wt,bt,trackedBits);
+        trackDFE(*rxBurst,trackedBits,TSC,0.1,wt,bt,&trainingErr);
+        if (n > numBursts/2) {
+          for (unsigned i = 3; i < 145; i++) {
+            staticErr += fabs(staticBits[i]-dataBurst.bit(i));
+            trackedErr += fabs(trackedBits[i]-dataBurst.bit(i));
+          }
+        }
+      }
+      delete txBurst;
+      delete rxNoise;
+    }
+    cout << "DFE tracking, mean soft bit error: static " << staticErr/(numBursts/2*142)
+         << ", tracked " << trackedErr/(numBursts/2*142)
+         << ", last training error: " << trainingErr << endl;
+
+    // the per burst cost of a full design against a tracking step
+    const int numRuns = 20000;
+    Timeval designStart;
+    for (int i = 0; i < numRuns; i++)
+      designDFE(*chan,1000.0,w,b);
+    long designTime = designStart.elapsed();
+    Timeval trackStart;
+    for (int i = 0; i < numRuns; i++)
+      trackDFE(*rxBurst,trackedBits,TSC,0.0,wt,bt,&trainingErr);
+    long trackTime = trackStart.elapsed();
+    cout << "DFE cost, design us: " << 1000.0*designTime/numRuns
+         << ", track us: " << 1000.0*trackTime/numRuns << endl;
+    delete chan;
+    delete rxBurst;
+  }
+
   
   //delayVector(*rsVector2,6.932);
 
@@ -159,6 +341,134 @@ int main(int argc, char **argv) {
   delete DFEBurst;  
   */
 
+  // time the direct and FFT midamble searches over growing search windows
+  //   and sequence lengths to find the crossover of the two correlators
+  gConfig.set("Log.Level","INFO");
+  cout << "midamble search, sps, max TOA, direct us, FFT us, TOA difference" << endl;
+  for (int sps = 1; sps <= 8; sps *= 2) {
+    generateMidamble(*gsmPulse,sps,TSC);
+    signalVector *searchBurst = gaussianNoise(157*sps,1.0);
+    signalVector *midamble = modulateBurst(gTrainingSequence[TSC],*gsmPulse,0,sps);
+    midamble->segmentCopyTo(*searchBurst,0,midamble->size());
+    for (unsigned maxTOA = 4; maxTOA <= 56; maxTOA *= 2) {
+      const int numRuns = 2000;
+      complex directAmpl, fftAmpl;
+      float directTOA, fftTOA;
+      setCorrelatorType(DIRECT_CORRELATOR);
+      Timeval directStart;
+      for (int i = 0; i < numRuns; i++)
+        analyzeTrafficBurst(*searchBurst,TSC,3.0,sps,&directAmpl,&directTOA,maxTOA);
+      long directTime = directStart.elapsed();
+      setCorrelatorType(FFT_CORRELATOR);
+      Timeval fftStart;
+      for (int i = 0; i < numRuns; i++)
+        analyzeTrafficBurst(*searchBurst,TSC,3.0,sps,&fftAmpl,&fftTOA,maxTOA);
+      long fftTime = fftStart.elapsed();
+      cout << sps << ", " << maxTOA << ", "
+           << 1000.0*directTime/numRuns << ", " << 1000.0*fftTime/numRuns << ", "
+           << fabs(fftTOA-directTOA) << endl;
+    }
+    delete searchBurst;
+    delete midamble;
+  }
+
+  // the RACH search correlates the whole burst against a longer sequence
+  cout << "RACH search, sps, direct us, FFT us, TOA difference" << endl;
+  for (int sps = 1; sps <= 8; sps *= 2) {
+    generateRACHSequence(*gsmPulse,sps);
+    signalVector *searchBurst = gaussianNoise(157*sps,1.0);
+    const int numRuns = 2000;
+    complex directAmpl, fftAmpl;
+    float directTOA, fftTOA;
+    setCorrelatorType(DIRECT_CORRELATOR);
+    Timeval directStart;
+    for (int i = 0; i < numRuns; i++)
+      detectRACHBurst(*searchBurst,0.0,sps,&directAmpl,&directTOA);
+    long directTime = directStart.elapsed();
+    setCorrelatorType(FFT_CORRELATOR);
+    Timeval fftStart;
+    for (int i = 0; i < numRuns; i++)
+      detectRACHBurst(*searchBurst,0.0,sps,&fftAmpl,&fftTOA);
+    long fftTime = fftStart.elapsed();
+    cout << sps << ", "
+         << 1000.0*directTime/numRuns << ", " << 1000.0*fftTime/numRuns << ", "
+         << fabs(fftTOA-directTOA) << endl;
+    delete searchBurst;
+  }
+  setCorrelatorType(AUTO_CORRELATOR);
+
+  // synthesize a tone on one channel, split it again, and report the
+  //   power that lands on every channel relative to the loaded one
+  cout << "filterbank, paths, loaded channel, channel, relative power dB" << endl;
+  for (int paths = 2; paths <= 8; paths *= 2) {
+    const int len = 4096;
+    Synthesizer synth(paths,24,len);
+    Channelizer chan(paths,24,len);
+    short *wide = new short[2*len*paths];
+    float **bufs = new float*[paths];
+    for (int k = 0; k < paths; k++) bufs[k] = NULL;
+    float *tone = new float[2*len];
+    for (int i = 0; i < len; i++) {
+      tone[2*i] = 8000.0*cos(2.0*M_PI*0.05*i);
+      tone[2*i+1] = 8000.0*sin(2.0*M_PI*0.05*i);
+    }
+    bufs[1] = tone;
+    synth.rotate(bufs,len,wide);
+    for (int k = 0; k < paths; k++) bufs[k] = new float[2*len];
+    delete[] tone;
+    chan.rotate(wide,len,bufs);
+    double ref = 0.0;
+    double pwr[8];
+    for (int k = 0; k < paths; k++) {
+      pwr[k] = 0.0;
+      for (int i = len/2; i < len; i++)
+        pwr[k] += bufs[k][2*i]*bufs[k][2*i] + bufs[k][2*i+1]*bufs[k][2*i+1];
+      if (k == 1) ref = pwr[k];
+    }
+    for (int k = 0; k < paths; k++)
+      cout << paths << ", 1, " << k << ", " << 10.0*log10(pwr[k]/ref + 1e-20) << endl;
+    for (int k = 0; k < paths; k++) delete[] bufs[k];
+    delete[] bufs;
+    delete[] wide;
+  }
+
+  // stream noise through the resampler in odd sized pieces and compare
+  //   against the one-shot polyphase resampler, both 65/96 directions
+  cout << "streaming resampler, P, Q, outputs, max error relative to peak" << endl;
+  for (int dir = 0; dir < 2; dir++) {
+    int P = dir ? 96 : 65;
+    int Q = dir ? 65 : 96;
+    float cutoff = (P < Q) ? (1.0/(float) Q) : (1.0/(float) P);
+    signalVector *lpf = createLPF(cutoff,dir ? 651 : 961,P);
+    const int len = 5000;
+    signalVector *x = gaussianNoise(len,1000.0);
+    signalVector *ref = polyphaseResampleVector(*x,P,Q,lpf);
+    Resampler resampler(P,Q,*lpf,1000);
+    const float *in = (const float *) x->begin();
+    float *out = new float[2*ref->size()];
+    const int pieces[] = {1, 7, 13, 101, 333, 997};
+    int numIn = 0, numOut = 0;
+    for (int k = 0; numIn < len; k++) {
+      int n = pieces[k % 6];
+      if (n > len-numIn) n = len-numIn;
+      numOut += resampler.rotate(in+2*numIn,n,out+2*numOut,ref->size()-numOut);
+      numIn += n;
+    }
+    float maxErr = 0.0, peak = 0.0;
+    for (int i = 0; i < numOut; i++) {
+      complex y(out[2*i],out[2*i+1]);
+      float err = (y-(*ref)[i]).abs();
+      if (err > maxErr) maxErr = err;
+      if ((*ref)[i].abs() > peak) peak = (*ref)[i].abs();
+    }
+    cout << P << ", " << Q << ", " << numOut << " of " << ref->size() << ", "
+         << maxErr/peak << endl;
+    delete[] out;
+    delete ref;
+    delete x;
+    delete lpf;
+  }
+
   sigProcLibDestroy();
 
 }
@@ -118,7 +118,8 @@ SIP::SIPInterface gSIPInterface;
 GSMConfig gBTS;
 
 /// Our interface to the software-defined radio.
-TransceiverManager gTRX(1, gConfig.getStr("TRX.IP"), gConfig.getNum("TRX.Port"));
+TransceiverManager gTRX(gConfig.defines("GSM.NumARFCNs") ? gConfig.getNum("GSM.NumARFCNs") : 1,
+	gConfig.getStr("TRX.IP"), gConfig.getNum("TRX.Port"));
 
 /// Pointer to the server socket if we run remote CLI.
 static ConnectionServerSocket *sgCLIServerSock = NULL;
@@ -222,13 +223,21 @@ static int startTransceiver()
 		// Start transceiver
 		const char *TRXPath = gConfig.getStr("TRX.Path");
 		const char *TRXLogLevel = gConfig.getStr("TRX.LogLevel");
-		const char *TRXLogFileName = NULL;
+		const char *TRXLogFileName = "";
 		if (gConfig.defines("TRX.LogFileName")) TRXLogFileName=gConfig.getStr("TRX.LogFileName");
+		char TRXNumARFCNs[16];
+		sprintf(TRXNumARFCNs,"%u",gTRX.numARFCNs());
+		const char *TRXThreadProfile = "";
+		if (gConfig.defines("TRX.ThreadProfile")) TRXThreadProfile=gConfig.getStr("TRX.ThreadProfile");
+		const char *TRXDevice = "";
+		if (gConfig.defines("TRX.Device")) TRXDevice=gConfig.getStr("TRX.Device");
+		const char *TRXCapture = "";
+		if (gConfig.defines("TRX.Capture")) TRXCapture=gConfig.getStr("TRX.Capture");
 		sgTransceiverPid = vfork();
 		LOG_ASSERT(sgTransceiverPid>=0);
 		if (sgTransceiverPid==0) {
 			// Pid==0 means this is the process that starts the transceiver.
-			execl(TRXPath,"transceiver",TRXLogLevel,TRXLogFileName,NULL);
+			execl(TRXPath,"transceiver",TRXLogLevel,TRXLogFileName,TRXNumARFCNs,TRXThreadProfile,TRXDevice,TRXCapture,NULL);
 			LOG(ERROR) << "cannot start transceiver";
 			_exit(0);
 		}
@@ -526,27 +535,45 @@ int main(int argc, char *argv[])
 	sleep(5);
 	gTRX.start();
 
-	// Set up the interface to the radio.
-	// Get a handle to the C0 transceiver interface.
-	ARFCNManager* radio = gTRX.ARFCN(0);
+	// Set up the interfaces to the radio.
+	// Every ARFCN of a multi-carrier transceiver shares one radio,
+	// so the carriers are spaced two ARFCNs (400 kHz) apart.
+	for (unsigned CN=0; CN<gTRX.numARFCNs(); CN++) {
+		ARFCNManager* radio = gTRX.ARFCN(CN);
+
+		// Tuning.
+		// Make sure its off for tuning.
+		radio->powerOff();
+		// Set TSC same as BCC everywhere.
+		radio->setTSC(gBTS.BCC());
+		// Tune.
+		radio->tune(gConfig.getNum("GSM.ARFCN") + 2*CN);
+
+		// Carry bursts through shared memory rather than UDP.
+		if (gConfig.defines("TRX.SharedMemory")) radio->useSharedMemory();
+
+		// Turn on and power up.
+		radio->powerOn();
+		radio->setPower(gConfig.getNum("GSM.PowerManager.MinAttenDB"));
 
-	// Tuning.
-	// Make sure its off for tuning.
-	radio->powerOff();
-	// Set TSC same as BCC everywhere.
-	radio->setTSC(gBTS.BCC());
-	// Tune.
-	radio->tune(gConfig.getNum("GSM.ARFCN"));
+		// Set maximum expected delay spread.
+		radio->setMaxDelay(gConfig.getNum("GSM.MaxExpectedDelaySpread"));
 
-	// Turn on and power up.
-	radio->powerOn();
-	radio->setPower(gConfig.getNum("GSM.PowerManager.MinAttenDB"));
+		// Set Receiver Gain
+		radio->setRxGain(gConfig.getNum("GSM.RxGain"));
 
-	// Set maximum expected delay spread.
-	radio->setMaxDelay(gConfig.getNum("GSM.MaxExpectedDelaySpread"));
+		// Batch the bursts of each frame on the data interface.
+		if (gConfig.defines("TRX.BurstBatch")) radio->setBurstBatch(gConfig.getNum("TRX.BurstBatch"));
 
-	// Set Receiver Gain
-	radio->setRxGain(gConfig.getNum("GSM.RxGain"));
+		// Soft bit format of received bursts.
+		if (gConfig.defines("TRX.RxFormat")) {
+			ARFCNManager::RxFormat format = (ARFCNManager::RxFormat)gConfig.getNum("TRX.RxFormat");
+			for (unsigned TN=0; TN<8; TN++) radio->setRxFormat(TN,format);
+		}
+	}
+
+	// Get a handle to the C0 transceiver interface.
+	ARFCNManager* radio = gTRX.ARFCN(0);
 
 	// C-V on C0T0
 	radio->setSlot(0,5);
@@ -607,14 +634,14 @@ int main(int argc, char *argv[])
 
 	// Create C-VII slots.
 	for (int i=0; i<gConfig.getNum("GSM.NumC7s"); i++) {
-		gBTS.createCombinationVII(gTRX,sCount/8,sCount);
+		gBTS.createCombinationVII(gTRX,sCount/8,sCount%8);
 		if (halfDuplex) sCount++;
 		sCount++;
 	}
 
 	// Create C-I slots.
 	for (int i=0; i<gConfig.getNum("GSM.NumC1s"); i++) {
-		gBTS.createCombinationI(gTRX,sCount/8,sCount);
+		gBTS.createCombinationI(gTRX,sCount/8,sCount%8);
 		if (halfDuplex) sCount++;
 		sCount++;
 	}
@@ -622,7 +649,7 @@ int main(int argc, char *argv[])
 
 	// Set up idle filling on C0 as needed.
 	while (sCount<8) {
-		gBTS.createCombination0(gTRX,sCount/8,sCount);
+		gBTS.createCombination0(gTRX,sCount/8,sCount%8);
 		if (halfDuplex) sCount++;
 		sCount++;
 	}